@@ -0,0 +1,169 @@
+/*
+ *  File name:  aes_ccm.c
+ *  Date first: 10/19/2026
+ *  Date last:  10/19/2026
+ *
+ *  Description: AES-CCM authenticated encryption for STM8 processor.
+ *
+ *  Author:     Richard Hodges
+ *
+ ******************************************************************************
+ *
+ *  Copyright (C) 2026 Richard Hodges.  All rights reserved.
+ *  Permission is hereby granted for any use.
+ *
+ ******************************************************************************
+ *
+ *  Includes
+ */
+#include <string.h>
+#include "aes_stm8.h"
+#include "aes_ccm.h"
+
+/******************************************************************************
+ *
+ *  Locals
+ */
+
+static char ccm_crypt(AES_CTX *, BYTE *, BYTE *, BYTE, BYTE *, BYTE,
+		      BYTE *, BYTE, char);
+static void ccm_block(AES_CTX *, BYTE *, BYTE *, BYTE);
+static void ccm_mac(AES_CTX *, BYTE *, BYTE, BYTE *, BYTE);
+
+/******************************************************************************
+ *
+ *  Encrypt payload in place and make tag
+ *
+ *  in:  AES_CTX, nonce, header, header length, payload, payload length,
+ *       tag buffer, tag length
+ * out: zero = success, else bad tag length
+ */
+
+char aes_ccm_encrypt(AES_CTX *ctx, BYTE *nonce, BYTE *hdr, BYTE hlen,
+		     BYTE *data, BYTE dlen, BYTE *tag, BYTE tlen)
+{
+    return ccm_crypt(ctx, nonce, hdr, hlen, data, dlen, tag, tlen, 0);
+}
+
+/******************************************************************************
+ *
+ *  Decrypt payload in place and check tag
+ *
+ *  in:  AES_CTX, nonce, header, header length, payload, payload length,
+ *       received tag, tag length
+ * out: zero = tag is good
+ */
+
+char aes_ccm_decrypt(AES_CTX *ctx, BYTE *nonce, BYTE *hdr, BYTE hlen,
+		     BYTE *data, BYTE dlen, BYTE *tag, BYTE tlen)
+{
+    return ccm_crypt(ctx, nonce, hdr, hlen, data, dlen, tag, tlen, 1);
+}
+
+/******************************************************************************
+ *
+ *  CCM encrypt or decrypt, single pass over the payload
+ *
+ *  The CBC-MAC is run on the plaintext 16 bytes at a time, right before
+ *  (encrypt) or right after (decrypt) the CTR key stream is applied.
+ *
+ *  in:  (as above), decrypt flag
+ * out: zero = success (encrypt) or tag is good (decrypt)
+ */
+
+static char ccm_crypt(AES_CTX *ctx, BYTE *nonce, BYTE *hdr, BYTE hlen,
+		      BYTE *data, BYTE dlen, BYTE *tag, BYTE tlen,
+		      char decrypt)
+{
+    BYTE	 mac[16];	/* CBC-MAC state */
+    BYTE	 s[16];		/* counter block, then key stream */
+    BYTE	 count, len, i;
+    BYTE	 diff;
+
+    if (tlen < 4 || tlen > 16 || (tlen & 1))
+	return 1;
+
+/* B0: flags, nonce, payload length */
+
+    mac[0] = ((tlen - 2) << 2) | 1;	/* M' = (M - 2) / 2, L' = 1 */
+    if (hlen)
+	mac[0] |= 0x40;
+    memcpy(mac + 1, nonce, CCM_NONCE);
+    mac[14] = 0;
+    mac[15] = dlen;
+    aes_encrypt(ctx, mac);
+
+/* Header is prefixed with 2-byte length, zero padded to block */
+
+    if (hlen) {
+	mac[1] ^= hlen;
+	ccm_mac(ctx, mac, 2, hdr, hlen);
+    }
+
+/* Payload, counters start at 1 */
+
+    count = 1;
+    while (dlen) {
+	len = dlen < 16 ? dlen : 16;
+	if (!decrypt)
+	    ccm_mac(ctx, mac, 0, data, len);
+	ccm_block(ctx, s, nonce, count);
+	for (i = 0; i < len; i++)
+	    data[i] ^= s[i];
+	if (decrypt)
+	    ccm_mac(ctx, mac, 0, data, len);
+	data += len;
+	dlen -= len;
+	count++;
+    }
+
+/* Tag is MAC encrypted with counter zero */
+
+    ccm_block(ctx, s, nonce, 0);
+    diff = 0;
+    for (i = 0; i < tlen; i++) {
+	if (decrypt)
+	    diff |= tag[i] ^ mac[i] ^ s[i];
+	else
+	    tag[i] = mac[i] ^ s[i];
+    }
+    return diff != 0;
+}
+
+/******************************************************************************
+ *
+ *  Make key stream block from counter
+ *
+ *  in: AES_CTX, block, nonce, counter
+ */
+
+static void ccm_block(AES_CTX *ctx, BYTE *s, BYTE *nonce, BYTE count)
+{
+    s[0] = 1;			/* L' = 1 */
+    memcpy(s + 1, nonce, CCM_NONCE);
+    s[14] = 0;
+    s[15] = count;
+    aes_encrypt(ctx, s);
+}
+
+/******************************************************************************
+ *
+ *  Add data to CBC-MAC, zero pad the last block
+ *
+ *  in: AES_CTX, MAC state, position in block, data, length
+ */
+
+static void ccm_mac(AES_CTX *ctx, BYTE *mac, BYTE pos, BYTE *data, BYTE len)
+{
+    while (len) {
+	mac[pos] ^= *data++;
+	pos++;
+	len--;
+	if (pos == 16) {
+	    aes_encrypt(ctx, mac);
+	    pos = 0;
+	}
+    }
+    if (pos)
+	aes_encrypt(ctx, mac);
+}
@@ -0,0 +1,43 @@
+/*
+ *  Program:  aes_ccm.h
+ *
+ *  Date first: 10/19/2026
+ *  Date last:  10/19/2026
+ *
+ *  Author:  Richard Hodges
+ *
+ *  AES-CCM authenticated encryption (RFC 3610, IEEE 802.15.4) for short
+ *  frames, using the aes_stm8 block cipher. The payload is encrypted or
+ *  decrypted in place, and only two 16-byte blocks are used on the stack.
+ *
+ ******************************************************************************
+ *
+ *  Copyright (C) 2026 Richard Hodges.  All rights reserved.
+ *  Permission is hereby granted for any use.
+ *
+ ******************************************************************************
+ *
+ *  Nonce is 13 bytes (length field L = 2), as used by IEEE 802.15.4.
+ *  Header and payload are each limited to 255 bytes.
+ *  Tag length is 4, 6, 8, 10, 12, 14, or 16 bytes.
+ */
+
+#define CCM_NONCE	13
+
+/*
+ *  Encrypt payload in place and make tag
+ *  in:  AES_CTX, nonce, header, header length, payload, payload length,
+ *       tag buffer, tag length
+ * out: zero = success, else bad tag length
+ */
+char aes_ccm_encrypt(AES_CTX *, BYTE *, BYTE *, BYTE, BYTE *, BYTE,
+		     BYTE *, BYTE);
+
+/*
+ *  Decrypt payload in place and check tag
+ *  in:  AES_CTX, nonce, header, header length, payload, payload length,
+ *       received tag, tag length
+ * out: zero = tag is good (if not, payload must be discarded)
+ */
+char aes_ccm_decrypt(AES_CTX *, BYTE *, BYTE *, BYTE, BYTE *, BYTE,
+		     BYTE *, BYTE);
@@ -1,7 +1,7 @@
 /*
  *  File name:  aes_stm8.c
  *  Date first: 12/05/2017
- *  Date last:  12/17/2017
+ *  Date last:  10/19/2026
  *
  *  Description: AES 128-bit code for STM8 processor.
  *
@@ -18,41 +18,63 @@
  */
 #include <string.h>
 #include "aes_stm8.h"
+#include "aes_tables.h"		/* S-box and column mix lookup tables */
 
 /******************************************************************************
  *
  *  Differences between SDCC and COSMIC
  *
  *  Note that SDCC pushes all pointers on the stack before calling, and
- *  Cosmic puts the rightmost (or only) pointer in X. There is only one
- *  assembly function that takes two pointers, and it has to deal with
- *  the Cosmic compiler making all calls far. The others can just use
- *  the pointer given in X.
+ *  Cosmic puts the rightmost (or only) pointer in X. There are only two
+ *  assembly functions that take two pointers (mix_key, round_enc_fused),
+ *  and they have to deal with the Cosmic compiler making all calls far.
+ *  The others can just use the pointer given in X.
  */
 
 //#define COSMIC		/* if not defined, assume SDCC */
 
 /******************************************************************************
  *
- *  Locals
+ *  Table lookups from assembly
+ *
+ *  If aes_tables.h was made with "-a", each table starts on a 256 byte
+ *  boundary. XH is loaded with the table page once, and each lookup only
+ *  sets XL and uses "ld a, (x)". Otherwise XH is zero and the table
+ *  address is the offset.
  */
 
-static void round_enc(AES_CTX *);
-static void round_dec(AES_CTX *);
+#ifdef AES_TABLES_ALIGNED
+#define SBOX_ENC	(x)
+#define SBOX_DEC	(x)
+#define MIX_2		(x)
+#else
+#define SBOX_ENC	(_sbox_tab_enc, x)
+#define SBOX_DEC	(_sbox_tab_dec, x)
+#define MIX_2		(_mix_2, x)
+#endif
 
-static void mix_col_dec(BYTE *);
-static void mix_col_enc(BYTE *);
+/******************************************************************************
+ *
+ *  Locals
+ */
+
+static void round_enc_fused(BYTE *, BYTE *);
 static BYTE mix_mul2(BYTE);
 
 static BYTE sbox_enc(BYTE);
 static void sbox_enc_block(BYTE *);
-static void sbox_dec_block(BYTE *);
 
 static void mix_key(BYTE *, BYTE *);
 
-static void shift_dec(BYTE *);
 static void shift_enc(BYTE *);
 
+#ifndef AES_ENCRYPT_ONLY
+static void round_dec(AES_CTX *);
+static void mix_col_dec(BYTE *);
+static void sbox_dec_block(BYTE *);
+static void shift_dec(BYTE *);
+#endif
+
 /******************************************************************************
  *
  *  Encrypt a block using this library
@@ -62,19 +84,42 @@ static void shift_enc(BYTE *);
 
 void aes_encrypt(AES_CTX *ctx, BYTE *block)
 {
-    int		 i;
+    aes_encrypt_blocks(ctx, block, 1);
+}
 
-    ctx->block = block;
+/******************************************************************************
+ *
+ *  Encrypt consecutive blocks (ECB, or CTR counter blocks)
+ *
+ *  The round key pointer and count are kept in locals rather than
+ *  reloaded through AES_CTX each round.
+ *
+ *  in: key, buffer, number of 16 byte blocks
+ */
 
-    mix_key(block, ctx->key[0]);
+void aes_encrypt_blocks(AES_CTX *ctx, BYTE *buf, BYTE nblocks)
+{
+    BYTE	*key;
+    BYTE	 r;
 
-    ctx->round = 1;
-    for (i = 0; i < 10; i++) {
-	round_enc(ctx);
+    while (nblocks--) {
+	key = ctx->key[0];
+	mix_key(buf, key);
+
+	for (r = 9; r; r--) {
+	    key += 16;
+	    round_enc_fused(buf, key);
+	}
+	key += 16;
+	sbox_enc_block(buf);
+	shift_enc(buf);
+	mix_key(buf, key);
 
+	buf += 16;
     }
 }
 
+#ifndef AES_ENCRYPT_ONLY
 /******************************************************************************
  *
  *  Decrypt a block using this library
@@ -121,34 +166,9 @@ static void round_dec(AES_CTX *ctx)
 
     sbox_dec_block(ctx->block);
 }
+#endif	/* AES_ENCRYPT_ONLY */
 
-/******************************************************************************
- *
- *  Do encryption round
- *
- *  in: AES_CTX
- */
-
-static void round_enc(AES_CTX *ctx)
-{
-    int		 r;
-
-    sbox_enc_block(ctx->block);
-
-    shift_enc(ctx->block);
-
-    if (ctx->round != 10) {
-	mix_col_enc(ctx->block +  0);
-	mix_col_enc(ctx->block +  4);
-	mix_col_enc(ctx->block +  8);
-	mix_col_enc(ctx->block + 12);
-    }
-    r = ctx->round;
-
-    mix_key(ctx->block, ctx->key[r]);
-    ctx->round++;
-}
-
+#ifndef AES_ENCRYPT_ONLY
 /******************************************************************************
  *
  *  Shift block rows, decrypt
@@ -228,6 +248,7 @@ __endasm;
 #endif
 #endif
 }
+#endif	/* AES_ENCRYPT_ONLY */
 
 /******************************************************************************
  *
@@ -329,106 +350,341 @@ static BYTE mix_mul2(BYTE val)
 
 /******************************************************************************
  *
- *  Mix column, encryption
+ *  Encryption round with column mix (rounds 1 to 9)
  *
- *  in: column
+ *  The S-box and row shift are done in one pass with indexing, then each
+ *  column is mixed and the round key applied before it is written back.
+ *  Mix uses x2(a ^ b) ^ a ^ (a0 ^ a1 ^ a2 ^ a3), so only mix_2 is needed.
+ *
+ *  in: block, round key
  */
 
-static void mix_col_enc(BYTE *c)
+static void round_enc_fused(BYTE *block, BYTE *key)
 {
 #ifdef ORIG_C
-    BYTE	 x1[4];
-    BYTE	 x2[4];
-    BYTE	 x3[4];
+    static const BYTE shift[16] = {
+	0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6, 11
+    };
+    BYTE	 t[16];
+    BYTE	 s;
     int		 i;
 
-    for (i = 0; i < 4; i++) {
-	x1[i] = c[i];
-	x2[i] = mix_mul2(x1[i]);
-	x3[i] = x2[i] ^ x1[i];
+    for (i = 0; i < 16; i++)
+	t[i] = sbox_tab_enc[block[shift[i]]];
+
+    for (i = 0; i < 16; i += 4) {
+	s = t[i] ^ t[i + 1] ^ t[i + 2] ^ t[i + 3];
+	block[i]     = mix_mul2(t[i]     ^ t[i + 1]) ^ s ^ t[i]     ^ key[i];
+	block[i + 1] = mix_mul2(t[i + 1] ^ t[i + 2]) ^ s ^ t[i + 1] ^ key[i + 1];
+	block[i + 2] = mix_mul2(t[i + 2] ^ t[i + 3]) ^ s ^ t[i + 2] ^ key[i + 2];
+	block[i + 3] = mix_mul2(t[i + 3] ^ t[i])     ^ s ^ t[i + 3] ^ key[i + 3];
     }
-    c[0] = x2[0] ^ x3[1] ^ x1[2] ^ x1[3];
-    c[1] = x1[0] ^ x2[1] ^ x3[2] ^ x1[3];
-    c[2] = x1[0] ^ x1[1] ^ x2[2] ^ x3[3];
-    c[3] = x3[0] ^ x1[1] ^ x1[2] ^ x2[3];
 #else
-    c;
+    block;
+    key;
 
-/* SP + 13, 14 return pointer
- * SP + 10..12 col 3 x1, x2, x3
- * SP +  7..9  col 2 x1, x2, x3
- * SP +  4..6  col 1 x1, x2, x3
- * SP +  1..3  col 0 x1, x2, x3
+/* SP + 21, 22 key pointer
+ * SP + 19, 20 block pointer
+ * SP + 18     column byte 0
+ * SP + 17     column sum (a0 ^ a1 ^ a2 ^ a3)
+ * SP +  1..16 state after S-box and row shift
  */
 #ifdef COSMIC
 #asm
-    exgw	x, y		; y is column pointer
+    ldw		x, (1, sp)
+    ldw		y, (6, sp)
 #else
 __asm
-    ldw		y, (3, sp)	; y is column pointer
+    ldw		x, (3, sp)	; block
+    ldw		y, (5, sp)	; key
 #endif
+    pushw	y
+    pushw	x
+    sub		sp, #18
+
+    ldw		y, x		; y is block pointer
+#ifdef AES_TABLES_ALIGNED
+    ldw		x, #_sbox_tab_enc
+#else
     clrw	x
-    sub		sp, #12
+#endif
 
-    ld		a, (0, y)
+    ld		a, (y)
     ld		xl, a
+    ld		a, SBOX_ENC
     ld		(1, sp), a
-    ld		a, (_mix_2, x)
+
+    ld		a, (5, y)
+    ld		xl, a
+    ld		a, SBOX_ENC
     ld		(2, sp), a
-    ld		a, (_mix_3, x)
+
+    ld		a, (10, y)
+    ld		xl, a
+    ld		a, SBOX_ENC
     ld		(3, sp), a
 
-    ld		a, (1, y)
+    ld		a, (15, y)
     ld		xl, a
+    ld		a, SBOX_ENC
     ld		(4, sp), a
-    ld		a, (_mix_2, x)
+
+    ld		a, (4, y)
+    ld		xl, a
+    ld		a, SBOX_ENC
     ld		(5, sp), a
-    ld		a, (_mix_3, x)
+
+    ld		a, (9, y)
+    ld		xl, a
+    ld		a, SBOX_ENC
     ld		(6, sp), a
 
+    ld		a, (14, y)
+    ld		xl, a
+    ld		a, SBOX_ENC
+    ld		(7, sp), a
+
+    ld		a, (3, y)
+    ld		xl, a
+    ld		a, SBOX_ENC
+    ld		(8, sp), a
+
+    ld		a, (8, y)
+    ld		xl, a
+    ld		a, SBOX_ENC
+    ld		(9, sp), a
+
+    ld		a, (13, y)
+    ld		xl, a
+    ld		a, SBOX_ENC
+    ld		(10, sp), a
+
     ld		a, (2, y)
     ld		xl, a
+    ld		a, SBOX_ENC
+    ld		(11, sp), a
+
+    ld		a, (7, y)
+    ld		xl, a
+    ld		a, SBOX_ENC
+    ld		(12, sp), a
+
+    ld		a, (12, y)
+    ld		xl, a
+    ld		a, SBOX_ENC
+    ld		(13, sp), a
+
+    ld		a, (1, y)
+    ld		xl, a
+    ld		a, SBOX_ENC
+    ld		(14, sp), a
+
+    ld		a, (6, y)
+    ld		xl, a
+    ld		a, SBOX_ENC
+    ld		(15, sp), a
+
+    ld		a, (11, y)
+    ld		xl, a
+    ld		a, SBOX_ENC
+    ld		(16, sp), a
+
+    ldw		y, (21, sp)	; y is key pointer
+#ifdef AES_TABLES_ALIGNED
+    ldw		x, #_mix_2
+#endif
+
+    ld		a, (1, sp)	; column 0
+    ld		(18, sp), a
+    xor		a, (2, sp)
+    xor		a, (3, sp)
+    xor		a, (4, sp)
+    ld		(17, sp), a
+
+    ld		a, (1, sp)
+    xor		a, (2, sp)
+    ld		xl, a
+    ld		a, MIX_2
+    xor		a, (17, sp)
+    xor		a, (1, sp)
+    xor		a, (y)
+    ld		(1, sp), a
+
+    ld		a, (2, sp)
+    xor		a, (3, sp)
+    ld		xl, a
+    ld		a, MIX_2
+    xor		a, (17, sp)
+    xor		a, (2, sp)
+    xor		a, (1, y)
+    ld		(2, sp), a
+
+    ld		a, (3, sp)
+    xor		a, (4, sp)
+    ld		xl, a
+    ld		a, MIX_2
+    xor		a, (17, sp)
+    xor		a, (3, sp)
+    xor		a, (2, y)
+    ld		(3, sp), a
+
+    ld		a, (4, sp)
+    xor		a, (18, sp)
+    ld		xl, a
+    ld		a, MIX_2
+    xor		a, (17, sp)
+    xor		a, (4, sp)
+    xor		a, (3, y)
+    ld		(4, sp), a
+
+    ld		a, (5, sp)	; column 1
+    ld		(18, sp), a
+    xor		a, (6, sp)
+    xor		a, (7, sp)
+    xor		a, (8, sp)
+    ld		(17, sp), a
+
+    ld		a, (5, sp)
+    xor		a, (6, sp)
+    ld		xl, a
+    ld		a, MIX_2
+    xor		a, (17, sp)
+    xor		a, (5, sp)
+    xor		a, (4, y)
+    ld		(5, sp), a
+
+    ld		a, (6, sp)
+    xor		a, (7, sp)
+    ld		xl, a
+    ld		a, MIX_2
+    xor		a, (17, sp)
+    xor		a, (6, sp)
+    xor		a, (5, y)
+    ld		(6, sp), a
+
+    ld		a, (7, sp)
+    xor		a, (8, sp)
+    ld		xl, a
+    ld		a, MIX_2
+    xor		a, (17, sp)
+    xor		a, (7, sp)
+    xor		a, (6, y)
     ld		(7, sp), a
-    ld		a, (_mix_2, x)
+
+    ld		a, (8, sp)
+    xor		a, (18, sp)
+    ld		xl, a
+    ld		a, MIX_2
+    xor		a, (17, sp)
+    xor		a, (8, sp)
+    xor		a, (7, y)
     ld		(8, sp), a
-    ld		a, (_mix_3, x)
+
+    ld		a, (9, sp)	; column 2
+    ld		(18, sp), a
+    xor		a, (10, sp)
+    xor		a, (11, sp)
+    xor		a, (12, sp)
+    ld		(17, sp), a
+
+    ld		a, (9, sp)
+    xor		a, (10, sp)
+    ld		xl, a
+    ld		a, MIX_2
+    xor		a, (17, sp)
+    xor		a, (9, sp)
+    xor		a, (8, y)
     ld		(9, sp), a
 
-    ld		a, (3, y)
+    ld		a, (10, sp)
+    xor		a, (11, sp)
     ld		xl, a
+    ld		a, MIX_2
+    xor		a, (17, sp)
+    xor		a, (10, sp)
+    xor		a, (9, y)
     ld		(10, sp), a
-    ld		a, (_mix_2, x)
+
+    ld		a, (11, sp)
+    xor		a, (12, sp)
+    ld		xl, a
+    ld		a, MIX_2
+    xor		a, (17, sp)
+    xor		a, (11, sp)
+    xor		a, (10, y)
     ld		(11, sp), a
-    ld		a, (_mix_3, x)
+
+    ld		a, (12, sp)
+    xor		a, (18, sp)
+    ld		xl, a
+    ld		a, MIX_2
+    xor		a, (17, sp)
+    xor		a, (12, sp)
+    xor		a, (11, y)
     ld		(12, sp), a
 
-    exgw	x, y
+    ld		a, (13, sp)	; column 3
+    ld		(18, sp), a
+    xor		a, (14, sp)
+    xor		a, (15, sp)
+    xor		a, (16, sp)
+    ld		(17, sp), a
 
-    ld		a, (2, sp)	; col0 x2
-    xor		a, (6, sp)	; col1 x3
-    xor		a, (7, sp)	; col2 x1
-    xor		a, (10, sp)	; col3 x1
-    ld		(0, x), a
+    ld		a, (13, sp)
+    xor		a, (14, sp)
+    ld		xl, a
+    ld		a, MIX_2
+    xor		a, (17, sp)
+    xor		a, (13, sp)
+    xor		a, (12, y)
+    ld		(13, sp), a
 
-    ld		a, (1, sp)	; col0 x1
-    xor		a, (5, sp)	; col1 x2
-    xor		a, (9, sp)	; col2 x3
-    xor		a, (10, sp)	; col4 x1
-    ld		(1, x), a
+    ld		a, (14, sp)
+    xor		a, (15, sp)
+    ld		xl, a
+    ld		a, MIX_2
+    xor		a, (17, sp)
+    xor		a, (14, sp)
+    xor		a, (13, y)
+    ld		(14, sp), a
 
-    ld		a, (1, sp)	; col0 x1
-    xor		a, (4, sp)	; col1 x1
-    xor		a, (8, sp)	; col2 x2
-    xor		a, (12, sp)	; col3 x3
-    ld		(2, x), a
+    ld		a, (15, sp)
+    xor		a, (16, sp)
+    ld		xl, a
+    ld		a, MIX_2
+    xor		a, (17, sp)
+    xor		a, (15, sp)
+    xor		a, (14, y)
+    ld		(15, sp), a
 
-    ld		a, (3, sp)	; col0 x3
-    xor		a, (4, sp)	; col1 x1
-    xor		a, (7, sp)	; col2 x1
-    xor		a, (11, sp)	; col3 x2
-    ld		(3, x), a
+    ld		a, (16, sp)
+    xor		a, (18, sp)
+    ld		xl, a
+    ld		a, MIX_2
+    xor		a, (17, sp)
+    xor		a, (16, sp)
+    xor		a, (15, y)
+    ld		(16, sp), a
 
-    add		sp, #12
+    ldw		x, (19, sp)	; copy state to block
+    ldw		y, (1, sp)
+    ldw		(0, x), y
+    ldw		y, (3, sp)
+    ldw		(2, x), y
+    ldw		y, (5, sp)
+    ldw		(4, x), y
+    ldw		y, (7, sp)
+    ldw		(6, x), y
+    ldw		y, (9, sp)
+    ldw		(8, x), y
+    ldw		y, (11, sp)
+    ldw		(10, x), y
+    ldw		y, (13, sp)
+    ldw		(12, x), y
+    ldw		y, (15, sp)
+    ldw		(14, x), y
+
+    add		sp, #22
 #ifdef COSMIC
 #endasm
 #else
@@ -437,6 +693,7 @@ __endasm;
 #endif
 }
 
+#ifndef AES_ENCRYPT_ONLY
 /******************************************************************************
  *
  *  Mix column, decryption
@@ -569,46 +826,7 @@ __endasm;
 #endif
 #endif
 }
-
-/******************************************************************************
- *
- *  SBOX values, encryption
- */
-
-const BYTE sbox_tab_enc[256] = {
-    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
-    0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
-    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
-    0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
-    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc,
-    0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
-    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a,
-    0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
-    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
-    0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
-    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b,
-    0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
-    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85,
-    0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
-    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
-    0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
-    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17,
-    0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
-    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
-    0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
-    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
-    0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
-    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9,
-    0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
-    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6,
-    0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
-    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
-    0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
-    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94,
-    0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
-    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68,
-    0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
-};
+#endif	/* AES_ENCRYPT_ONLY */
 
 /******************************************************************************
  *
@@ -632,6 +850,12 @@ static BYTE sbox_enc(BYTE val)
 
 void sbox_enc_block(BYTE *block)
 {
+#ifdef ORIG_C
+    int		 i;
+
+    for (i = 0; i < 16; i++)
+	block[i] = sbox_tab_enc[block[i]];
+#else
     block;
 #ifdef COSMIC
 #asm
@@ -640,86 +864,90 @@ void sbox_enc_block(BYTE *block)
 __asm
     ldw		y, (3, sp)
 #endif
+#ifdef AES_TABLES_ALIGNED
+    ldw		x, #_sbox_tab_enc
+#else
     clrw	x
+#endif
 
     ld		a, (y)
     ld		xl, a
-    ld		a, (_sbox_tab_enc, x)
+    ld		a, SBOX_ENC
     ld		(y), a
 
     ld		a, (1, y)
     ld		xl, a
-    ld		a, (_sbox_tab_enc, x)
+    ld		a, SBOX_ENC
     ld		(1, y), a
 
     ld		a, (2, y)
     ld		xl, a
-    ld		a, (_sbox_tab_enc, x)
+    ld		a, SBOX_ENC
     ld		(2, y), a
 
     ld		a, (3, y)
     ld		xl, a
-    ld		a, (_sbox_tab_enc, x)
+    ld		a, SBOX_ENC
     ld		(3, y), a
 
     ld		a, (4, y)
     ld		xl, a
-    ld		a, (_sbox_tab_enc, x)
+    ld		a, SBOX_ENC
     ld		(4, y), a
 
     ld		a, (5, y)
     ld		xl, a
-    ld		a, (_sbox_tab_enc, x)
+    ld		a, SBOX_ENC
     ld		(5, y), a
 
     ld		a, (6, y)
     ld		xl, a
-    ld		a, (_sbox_tab_enc, x)
+    ld		a, SBOX_ENC
     ld		(6, y), a
 
     ld		a, (7, y)
     ld		xl, a
-    ld		a, (_sbox_tab_enc, x)
+    ld		a, SBOX_ENC
     ld		(7, y), a
 
     ld		a, (8, y)
     ld		xl, a
-    ld		a, (_sbox_tab_enc, x)
+    ld		a, SBOX_ENC
     ld		(8, y), a
 
     ld		a, (9, y)
     ld		xl, a
-    ld		a, (_sbox_tab_enc, x)
+    ld		a, SBOX_ENC
     ld		(9, y), a
 
     ld		a, (10, y)
     ld		xl, a
-    ld		a, (_sbox_tab_enc, x)
+    ld		a, SBOX_ENC
     ld		(10, y), a
 
     ld		a, (11, y)
     ld		xl, a
-    ld		a, (_sbox_tab_enc, x)
+    ld		a, SBOX_ENC
     ld		(11, y), a
 
     ld		a, (12, y)
     ld		xl, a
-    ld		a, (_sbox_tab_enc, x)
+    ld		a, SBOX_ENC
     ld		(12, y), a
 
     ld		a, (13, y)
     ld		xl, a
-    ld		a, (_sbox_tab_enc, x)
+    ld		a, SBOX_ENC
     ld		(13, y), a
 
     ld		a, (14, y)
     ld		xl, a
-    ld		a, (_sbox_tab_enc, x)
+    ld		a, SBOX_ENC
     ld		(14, y), a
 
     ld		a, (15, y)
     ld		xl, a
-    ld		a, (_sbox_tab_enc, x)
+    ld		a, SBOX_ENC
     ld		(15, y), a
 
 #ifdef COSMIC
@@ -727,7 +955,9 @@ __asm
 #else
 __endasm;
 #endif
+#endif
 }
+#ifndef AES_ENCRYPT_ONLY
 /******************************************************************************
  *
  *  SBOX block substitution, decoding
@@ -737,6 +967,12 @@ __endasm;
 
 void sbox_dec_block(BYTE *block)
 {
+#ifdef ORIG_C
+    int		 i;
+
+    for (i = 0; i < 16; i++)
+	block[i] = sbox_tab_dec[block[i]];
+#else
     block;
 #ifdef COSMIC
 #asm
@@ -745,86 +981,90 @@ void sbox_dec_block(BYTE *block)
 __asm
     ldw		y, (3, sp)
 #endif
+#ifdef AES_TABLES_ALIGNED
+    ldw		x, #_sbox_tab_dec
+#else
     clrw	x
+#endif
 
     ld		a, (y)
     ld		xl, a
-    ld		a, (_sbox_tab_dec, x)
+    ld		a, SBOX_DEC
     ld		(y), a
 
     ld		a, (1, y)
     ld		xl, a
-    ld		a, (_sbox_tab_dec, x)
+    ld		a, SBOX_DEC
     ld		(1, y), a
 
     ld		a, (2, y)
     ld		xl, a
-    ld		a, (_sbox_tab_dec, x)
+    ld		a, SBOX_DEC
     ld		(2, y), a
 
     ld		a, (3, y)
     ld		xl, a
-    ld		a, (_sbox_tab_dec, x)
+    ld		a, SBOX_DEC
     ld		(3, y), a
 
     ld		a, (4, y)
     ld		xl, a
-    ld		a, (_sbox_tab_dec, x)
+    ld		a, SBOX_DEC
     ld		(4, y), a
 
     ld		a, (5, y)
     ld		xl, a
-    ld		a, (_sbox_tab_dec, x)
+    ld		a, SBOX_DEC
     ld		(5, y), a
 
     ld		a, (6, y)
     ld		xl, a
-    ld		a, (_sbox_tab_dec, x)
+    ld		a, SBOX_DEC
     ld		(6, y), a
 
     ld		a, (7, y)
     ld		xl, a
-    ld		a, (_sbox_tab_dec, x)
+    ld		a, SBOX_DEC
     ld		(7, y), a
 
     ld		a, (8, y)
     ld		xl, a
-    ld		a, (_sbox_tab_dec, x)
+    ld		a, SBOX_DEC
     ld		(8, y), a
 
     ld		a, (9, y)
     ld		xl, a
-    ld		a, (_sbox_tab_dec, x)
+    ld		a, SBOX_DEC
     ld		(9, y), a
 
     ld		a, (10, y)
     ld		xl, a
-    ld		a, (_sbox_tab_dec, x)
+    ld		a, SBOX_DEC
     ld		(10, y), a
 
     ld		a, (11, y)
     ld		xl, a
-    ld		a, (_sbox_tab_dec, x)
+    ld		a, SBOX_DEC
     ld		(11, y), a
 
     ld		a, (12, y)
     ld		xl, a
-    ld		a, (_sbox_tab_dec, x)
+    ld		a, SBOX_DEC
     ld		(12, y), a
 
     ld		a, (13, y)
     ld		xl, a
-    ld		a, (_sbox_tab_dec, x)
+    ld		a, SBOX_DEC
     ld		(13, y), a
 
     ld		a, (14, y)
     ld		xl, a
-    ld		a, (_sbox_tab_dec, x)
+    ld		a, SBOX_DEC
     ld		(14, y), a
 
     ld		a, (15, y)
     ld		xl, a
-    ld		a, (_sbox_tab_dec, x)
+    ld		a, SBOX_DEC
     ld		(15, y), a
 
 #ifdef COSMIC
@@ -832,47 +1072,9 @@ __asm
 #else
 __endasm;
 #endif
+#endif
 }
-
-/******************************************************************************
- *
- *  SBOX values, decryption
- */
-
-const BYTE sbox_tab_dec[256] = {
-    0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38,
-    0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
-    0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87,
-    0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
-    0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d,
-    0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
-    0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2,
-    0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
-    0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16,
-    0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
-    0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda,
-    0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
-    0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a,
-    0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
-    0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02,
-    0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
-    0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea,
-    0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
-    0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85,
-    0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
-    0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89,
-    0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
-    0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20,
-    0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
-    0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31,
-    0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
-    0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d,
-    0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
-    0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0,
-    0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
-    0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26,
-    0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
-};
+#endif	/* AES_ENCRYPT_ONLY */
 
 /******************************************************************************
  *
@@ -1024,4 +1226,69 @@ void aes_new_key(AES_CTX *ctx, BYTE *key)
     }
 }
 
-#include "aes_tables.h"		/* column mix lookup tables */
+
+#ifdef AES_SELFTEST
+/******************************************************************************
+ *
+ *  Known answer vectors: key, plaintext, ciphertext
+ *
+ *  1: FIPS-197 appendix C.1
+ *  2: FIPS-197 appendix B
+ *  3: AESAVS GFSbox, 128 bit key, count 0
+ */
+
+static const BYTE aes_kat[3][48] = {
+    {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+	0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+	0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+	0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+    },
+    {
+	0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+	0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+	0x32, 0x43, 0xf6, 0xa8, 0x88, 0x5a, 0x30, 0x8d,
+	0x31, 0x31, 0x98, 0xa2, 0xe0, 0x37, 0x07, 0x34,
+	0x39, 0x25, 0x84, 0x1d, 0x02, 0xdc, 0x09, 0xfb,
+	0xdc, 0x11, 0x85, 0x97, 0x19, 0x6a, 0x0b, 0x32
+    },
+    {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0xf3, 0x44, 0x81, 0xec, 0x3c, 0xc6, 0x27, 0xba,
+	0xcd, 0x5d, 0xc3, 0xfb, 0x08, 0xf2, 0x73, 0xe6,
+	0x03, 0x36, 0x76, 0x3e, 0x96, 0x6d, 0x92, 0x59,
+	0x5a, 0x56, 0x7c, 0xc9, 0xce, 0x53, 0x7f, 0x5e
+    }
+};
+
+/******************************************************************************
+ *
+ *  Run known answer tests, encrypt and decrypt
+ *
+ *  in: AES_CTX (key is overwritten, call aes_new_key() after)
+ * out: zero = pass, else number of first failed vector
+ */
+
+char aes_selftest(AES_CTX *ctx)
+{
+    BYTE	 block[16];
+    int		 i;
+
+    for (i = 0; i < 3; i++) {
+	aes_new_key(ctx, (BYTE *)aes_kat[i]);
+	memcpy(block, aes_kat[i] + 16, 16);
+	aes_encrypt(ctx, block);
+	if (memcmp(block, aes_kat[i] + 32, 16))
+	    return i + 1;
+#ifndef AES_ENCRYPT_ONLY
+	aes_decrypt(ctx, block);
+	if (memcmp(block, aes_kat[i] + 16, 16))
+	    return i + 1;
+#endif
+    }
+    return 0;
+}
+#endif	/* AES_SELFTEST */
@@ -2,7 +2,7 @@
  *  Program:  aes_stm8.h
  *
  *  Date first: 12/17/2017
- *  Date last:  12/17/2017
+ *  Date last:  10/19/2026
  *
  *  Author:  Richard Hodges
  * 
@@ -31,5 +31,22 @@ typedef struct {
 
 void aes_new_key(AES_CTX *, BYTE *);
 void aes_encrypt(AES_CTX *, BYTE *);
+void aes_encrypt_blocks(AES_CTX *, BYTE *, BYTE);
 void aes_decrypt(AES_CTX *, BYTE *);
 
+/*
+ *  Option to include known answer self test (FIPS-197, AESAVS).
+ *  Uncomment to check the build on target. "make test" runs it on the
+ *  host with the C versions (-DORIG_C -DAES_SELFTEST).
+ */
+
+//#define AES_SELFTEST
+
+#ifdef AES_SELFTEST
+/*
+ *  Run known answer tests (replaces the key in AES_CTX)
+ *  out: zero = pass, else number of first failed vector
+ */
+char aes_selftest(AES_CTX *);
+#endif
+
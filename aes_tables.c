@@ -1,9 +1,9 @@
 /*
  *  File name:  aes_tables.c
  *  Date first: 12/13/2017
- *  Date last:  12/13/2017
+ *  Date last:  10/19/2026
  *
- *  Description: Output AES mix tables.
+ *  Description: Output AES S-box and mix tables.
  *
  *  Author:     Richard Hodges
  *
@@ -12,6 +12,18 @@
  *
  ******************************************************************************
  *
+ *  Usage: aes_tables [-e] [-a address] > aes_tables.h
+ *
+ *  -e  Encrypt only. Output only the tables needed for aes_new_key() and
+ *      aes_encrypt() (eg, for CTR, CCM, or CMAC), and define
+ *      AES_ENCRYPT_ONLY so the decrypt code is left out.
+ *
+ *  -a  Place the tables at the given address, each on its own 256 byte
+ *      boundary, and define AES_TABLES_ALIGNED. The assembly can then
+ *      load the table page into XH once and index with XL only.
+ *
+ ******************************************************************************
+ *
  *  Includes
  */
 
@@ -32,7 +44,11 @@ typedef unsigned char BYTE;
 
 
 static BYTE mix_mul2(BYTE);
+static BYTE rotl(BYTE, int);
 static void print_table(char *, BYTE *);
+static void usage(char *);
+
+static long	table_addr;	/* aligned table address or zero */
 
 /******************************************************************************
  *
@@ -40,23 +56,38 @@ static void print_table(char *, BYTE *);
 
 int main(int argc, char *argv[])
 {
+    BYTE	sbox_enc[256];
+    BYTE	sbox_dec[256];
+    BYTE	exp_tab[256];
+    BYTE	log_tab[256];
     BYTE	x_2[256];
-    BYTE       	x_3[256];
     BYTE	x_9[256];
     BYTE	x_11[256];
     BYTE	x_13[256];
     BYTE	x_14[256];
-    int		i, val;
+    int		i, val, inv;
+    int		enc_only;
+
+    enc_only = 0;
+    table_addr = 0;
+    for (i = 1; i < argc; i++) {
+	if (!strcmp(argv[i], "-e"))
+	    enc_only = 1;
+	else if (!strcmp(argv[i], "-a") && i + 1 < argc)
+	    table_addr = strtol(argv[++i], NULL, 0);
+	else
+	    usage(argv[0]);
+    }
+    if (table_addr & 0xff)
+	usage(argv[0]);
 
     for (i = 0; i < 256; i++) {
 	val = i;
-	x_3[i]  = val;		/* x 1 */
-	x_9[i]  = val;
+	x_9[i]  = val;		/* x 1 */
 	x_11[i] = val;
 	x_13[i] = val;
 	val = mix_mul2(val);	/* x 2 */
 	x_2[i]   = val;
-	x_3[i]  ^= val;
 	x_11[i] ^= val;
 	x_14[i]  = val;
 	val = mix_mul2(val);	/* x 4 */
@@ -68,8 +99,35 @@ int main(int argc, char *argv[])
 	x_13[i] ^= val;
 	x_14[i] ^= val;
     }
+
+/* Powers of 3 give log and antilog, for multiplicative inverse */
+
+    val = 1;
+    for (i = 0; i < 255; i++) {
+	exp_tab[i] = val;
+	log_tab[val] = i;
+	val ^= mix_mul2(val);	/* x 3 */
+    }
+    for (i = 0; i < 256; i++) {
+	inv = i ? exp_tab[(255 - log_tab[i]) % 255] : 0;
+	val = inv ^ rotl(inv, 1) ^ rotl(inv, 2) ^ rotl(inv, 3) ^
+	    rotl(inv, 4) ^ 0x63;
+	sbox_enc[i] = val;
+	sbox_dec[val] = i;
+    }
+
+    printf("/* Generated by aes_tables, do not edit */\n\n");
+    if (enc_only)
+	printf("#define AES_ENCRYPT_ONLY\n\n");
+    if (table_addr)
+	printf("#define AES_TABLES_ALIGNED\n\n");
+
+    print_table("sbox_tab_enc", sbox_enc);
     print_table("mix_2", x_2);
-    print_table("mix_3", x_3);
+    if (enc_only)
+	return 0;
+
+    print_table("sbox_tab_dec", sbox_dec);
     print_table("mix_9", x_9);
     print_table("mix_11", x_11);
     print_table("mix_13", x_13);
@@ -87,6 +145,10 @@ static void print_table(char *tabname, BYTE *table)
 {
     int		 i, j;
 
+    if (table_addr) {
+	printf("__at (0x%04lx) ", table_addr);
+	table_addr += 256;
+    }
     printf("const BYTE %s[256] = {", tabname);
     for (i = 0; i < 32; i++) {
 	printf("\n    ");
@@ -111,3 +173,26 @@ static BYTE mix_mul2(BYTE val)
 
     return (retval);
 }
+
+/******************************************************************************
+ *
+ *  Rotate byte left, for S-box affine transform
+ */
+
+static BYTE rotl(BYTE val, int bits)
+{
+    return (val << bits) | (val >> (8 - bits));
+}
+
+/******************************************************************************
+ *
+ *  Show usage and quit
+ */
+
+static void usage(char *name)
+{
+    fprintf(stderr, "usage: %s [-e] [-a address]\n", name);
+    fprintf(stderr, "  -e  encrypt tables only\n");
+    fprintf(stderr, "  -a  place tables at address (multiple of 256)\n");
+    exit(1);
+}
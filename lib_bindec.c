@@ -1,13 +1,13 @@
 /*
  *  File name:  lib_bindec.c
  *  Date first: 12/22/2017
- *  Date last:  09/13/2022
+ *  Date last:  10/19/2026
  *
  *  Description: Library of binary/decimal functions for STM8
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2017, 2018, 2022 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2017, 2018, 2022, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
@@ -102,6 +102,11 @@ __endasm;
  *  Binary to decimal, terminate with zero
  *
  *  in:  binary (32 bits), 10 char buffer
+ *
+ *  Each pass divides the 32 bit value by 100 in place, one byte at a
+ *  time with "div x, a" (the remainder is under 100, so remainder:byte
+ *  never overflows 16 bits). The final remainder gives the next two
+ *  digits, written from the right. Five passes give ten digits.
  */
 
 void bin32_dec(long bin, char *dec)
@@ -110,162 +115,121 @@ void bin32_dec(long bin, char *dec)
 
 #ifdef __SDCC
 __asm
-    ldw		x, (7, sp)	; decimal buffer pointer
-    ldw		y, sp
-    addw	y, #3		; 32 bit binary on stack
-
-    clr	(x)			; zero the BCD area
-    clr	(1, x)
-    clr	(2, x)
-    clr	(3, x)
-    clr      	(4, x)
-
-    sub		sp, #2
-    ld		a, #32
-    ld		(1, sp), a
+    ldw		y, (7, sp)	; decimal buffer pointer
+    addw	y, #10
+    clr		(y)		; terminate
+    push	#5		; passes, 32 bit binary at (4, sp)
 
 00001$:
-    ld		a, #5
-    ld     	(2, sp), a
+    clrw	x		; remainder = 0
+    ld		a, (4, sp)
+    ld		xl, a
 
-00002$:
-    ld		a, #0x33	; assume DAA is needed
-    add		a, (x)
-    jrmi	00003$		; N set if nybble was 5-9
-    sub		a, #0x30	; nybble was 0-4, so undo DAA
-00003$:
-    add		a, #8		; push bit-3 into HC
-    jrh		00004$
-    sub		a, #3		; undo DAA
-00004$:
-    sub		a, #8		; undo add #8 above
-    ld		(x), a
+    ld		a, #100
+    div		x, a
+    exg		a, xl		; A = quotient, XL = remainder
+    ld		(4, sp), a
 
-    incw	x
-    dec		(2, sp)
-    jrne	00002$
-    subw	x, #5
-
-    rlc		(3, y)		; rotate 32 bit binary into BCD
-    rlc		(2, y)
-    rlc		(1, y)
-    rlc		(y)
-    rlc		(4, x)
-    rlc		(3, x)
-    rlc		(2, x)
-    rlc		(1, x)
-    rlc		(x)
+    swapw	x		; remainder to XH
+    ld		a, (5, sp)
+    ld		xl, a
 
-    dec		(1, sp)
-    jrne	00001$
+    ld		a, #100
+    div		x, a
+    exg		a, xl		; A = quotient, XL = remainder
+    ld		(5, sp), a
 
-    ldw		y, x
-    addw	y, #9
-    addw	x, #4
+    swapw	x		; remainder to XH
+    ld		a, (6, sp)
+    ld		xl, a
 
-    ld		a, #5
-    ld		(1, sp), a
-00005$:
-    ld		a, (x)
-    and		a, #0x0f
-    add		a, #'0'
-    ld		(y), a
-    decw	y
+    ld		a, #100
+    div		x, a
+    exg		a, xl		; A = quotient, XL = remainder
+    ld		(6, sp), a
 
-    ld		a, (x)
-    swap	a
-    and		a, #0x0f
+    swapw	x		; remainder to XH
+    ld		a, (7, sp)
+    ld		xl, a
+
+    ld		a, #100
+    div		x, a
+    exg		a, xl		; A = quotient, XL = remainder
+    ld		(7, sp), a
+
+    ld		a, #10		; last remainder is two digits
+    div		x, a
     add		a, #'0'
+    decw	y
     ld		(y), a
+    ld		a, xl
+    add		a, #'0'
     decw	y
-    decw	x
+    ld		(y), a
 
     dec		(1, sp)
-    jrne	00005$
-
-    clr		(11, y)
-    add		sp, #2
-
+    jrne	00001$
+    pop		a
 __endasm;
 #endif		/* SDCC */
 
 #ifdef COSMIC
 #asm
-    ldw		x, (8, sp)	; decimal buffer pointer
-    ldw		y, sp
-    addw	y, #4		; 32 bit binary on stack
+    ldw		y, (8, sp)	; decimal buffer pointer
+    addw	y, #10
+    clr		(y)		; terminate
+    push	#5		; passes, 32 bit binary at (5, sp)
+
+pass_loop:
+    clrw	x		; remainder = 0
+    ld		a, (5, sp)
+    ld		xl, a
 
-    clr		(x)		; zero the BCD area
-    clr		(1, x)
-    clr		(2, x)
-    clr		(3, x)
-    clr      	(4, x)
+    ld		a, #100
+    div		x, a
+    exg		a, xl		; A = quotient, XL = remainder
+    ld		(5, sp), a
 
-    sub		sp, #2
-    ld		a, #32
-    ld		(1, sp), a
+    swapw	x		; remainder to XH
+    ld		a, (6, sp)
+    ld		xl, a
 
-bit_loop:
-    ld		a, #5
-    ld     	(2, sp), a
-
-bcd_loop:
-    ld		a, #0x33	; assume DAA is needed
-    add		a, (x)
-    jrmi	daa_h		; N set if nybble was 5-9
-    sub		a, #0x30	; nybble was 0-4, so undo DAA
-daa_h:
-    add		a, #8		; push bit-3 into HC
-    jrh		daa_l
-    sub		a, #3		; undo DAA
-daa_l:
-    sub		a, #8		; undo add #8 above
-    ld		(x), a
+    ld		a, #100
+    div		x, a
+    exg		a, xl		; A = quotient, XL = remainder
+    ld		(6, sp), a
 
-    incw	x
-    dec		(2, sp)
-    jrne	bcd_loop
-    subw	x, #5
-
-    rlc		(3, y)		; rotate 32 bit binary into BCD
-    rlc		(2, y)
-    rlc		(1, y)
-    rlc		(y)
-    rlc		(4, x)
-    rlc		(3, x)
-    rlc		(2, x)
-    rlc		(1, x)
-    rlc		(x)
+    swapw	x		; remainder to XH
+    ld		a, (7, sp)
+    ld		xl, a
 
-    dec		(1, sp)
-    jrne       	bit_loop
+    ld		a, #100
+    div		x, a
+    exg		a, xl		; A = quotient, XL = remainder
+    ld		(7, sp), a
 
-    ldw		y, x
-    addw	y, #9
-    addw	x, #4
+    swapw	x		; remainder to XH
+    ld		a, (8, sp)
+    ld		xl, a
 
-    ld		a, #5
-    ld		(1, sp), a
-ascii_loop:
-    ld		a, (x)
-    and		a, #0x0f
-    add		a, #'0'
-    ld		(y), a
-    decw	y
+    ld		a, #100
+    div		x, a
+    exg		a, xl		; A = quotient, XL = remainder
+    ld		(8, sp), a
 
-    ld		a, (x)
-    swap	a
-    and		a, #0x0f
+    ld		a, #10		; last remainder is two digits
+    div		x, a
     add		a, #'0'
+    decw	y
     ld		(y), a
+    ld		a, xl
+    add		a, #'0'
     decw	y
-    decw	x
+    ld		(y), a
 
     dec		(1, sp)
-    jrne	ascii_loop
-
-    clr		(11, y)
-    add		sp, #2
+    jrne	pass_loop
+    pop		a
 #endasm
 #endif		/* COSMIC */
 }
@@ -448,3 +412,286 @@ int dec_bin16s(char *dec)
 	dec++;
     return dec_bin16(dec);
 }
+
+/******************************************************************************
+ *
+ *  Format signed fixed point binary as decimal, eg "-12.25"
+ *
+ *  in:  value, fraction bits (0-12), decimal places (0-4), 12 char buffer
+ *  out: string length
+ *
+ *  The fraction is produced by repeated multiply by 10, taking the bits
+ *  above the binary point as the next digit. No division is used for
+ *  the fraction, and digits are truncated rather than rounded.
+ */
+
+char fix16_dec(short val, char fbits, char places, char *buf)
+{
+    unsigned short	 mag;
+    unsigned short	 frac;
+    unsigned short	 mask;
+    char		*ptr;
+    char		*dig;
+
+    ptr = buf;
+    mag = val;
+    if (val < 0) {
+	*ptr++ = '-';
+	mag = -val;
+    }
+    mask = (1 << fbits) - 1;
+    frac = mag & mask;
+
+    bin16_dec(mag >> fbits, ptr);
+    dig = decimal_rlz(ptr, 4);
+    while (*dig)
+	*ptr++ = *dig++;
+
+    if (places) {
+	*ptr++ = '.';
+	while (places--) {
+	    frac = (frac << 3) + (frac << 1);
+	    *ptr++ = '0' + (frac >> fbits);
+	    frac &= mask;
+	}
+    }
+    *ptr = 0;
+    return ptr - buf;
+}
+
+/******************************************************************************
+ *
+ *  Format signed value scaled by a power of ten, eg 1225 -> "12.25"
+ *
+ *  in:  value, decimal places (0-4), 8 char buffer
+ *  out: string length
+ */
+
+char scaled_dec(short val, char places, char *buf)
+{
+    char		 tmp[6];
+    char		*ptr;
+    char		*dig;
+    char		 len;
+
+    ptr = buf;
+    if (val < 0) {
+	*ptr++ = '-';
+	val = -val;
+    }
+    bin16_dec(val, tmp);
+    dig = decimal_rlz(tmp, 4 - places);	/* keep a zero before the point */
+    len = 5 - (dig - tmp);
+
+    while (len) {
+	if (len == places)
+	    *ptr++ = '.';
+	*ptr++ = *dig++;
+	len--;
+    }
+    *ptr = 0;
+    return ptr - buf;
+}
+
+/******************************************************************************
+ *
+ *  Convert ASCII decimal with optional sign and fraction, eg "-12.25",
+ *  to signed fixed point binary
+ *
+ *  in:  string, fraction bits (0-12)
+ *  out: fixed point value, fraction rounded to nearest
+ *
+ *  Up to 4 decimal places are used, further digits are skipped.
+ *  Stops on first character that is not part of the number.
+ */
+
+short dec_fix16(char *dec, char fbits)
+{
+    unsigned long	 frac;
+    unsigned short	 div;
+    unsigned short	 ipart;
+    char		 neg;
+
+    neg = 0;
+    if (*dec == '-') {
+	neg = 1;
+	dec++;
+    }
+    else if (*dec == '+')
+	dec++;
+
+    ipart = 0;
+    while (*dec >= '0' && *dec <= '9')
+	ipart = (ipart * 10) + (*dec++ - '0');
+
+    frac = 0;
+    div = 1;
+    if (*dec == '.') {
+	dec++;
+	while (*dec >= '0' && *dec <= '9') {
+	    if (div < 10000) {
+		frac = (frac * 10) + (*dec - '0');
+		div *= 10;
+	    }
+	    dec++;
+	}
+    }
+    frac = ((frac << fbits) + (div >> 1)) / div;
+    ipart = (ipart << fbits) + (unsigned short)frac;
+
+    return neg ? -ipart : ipart;
+}
+
+/******************************************************************************
+ *
+ *  Convert 16 bit binary to 4 hex digits, terminate with zero
+ *  in: binary, buffer
+ */
+
+void bin16_hex(short val, char *hex)
+{
+#ifdef __SDCC
+    val, hex;
+__asm
+#if __SDCCCALL == 0
+    ldw		x, (3, sp)
+    ldw		y, (5, sp)
+#else
+    ldw		y, (3, sp)
+#endif
+    push	#2		; two bytes, high first
+00001$:
+    ld		a, xh
+    swap	a
+    and		a, #0x0f
+    add		a, #6
+    jrh		00002$
+    sub		a, #7
+00002$:
+    add		a, #'0'+1
+    ld		(y), a
+
+    ld		a, xh
+    and		a, #0x0f
+    add		a, #6
+    jrh		00003$
+    sub		a, #7
+00003$:
+    add		a, #'0'+1
+    ld		(1, y), a
+
+    addw	y, #2
+    swapw	x		; low byte to XH
+    dec		(1, sp)
+    jrne	00001$
+    pop		a
+    clr		(y)
+__endasm;
+#else
+    bin8_hex(val >> 8, hex);
+    bin8_hex(val, hex + 2);
+#endif
+}
+
+/******************************************************************************
+ *
+ *  Convert 32 bit binary to 8 hex digits, terminate with zero
+ *  in: binary, buffer
+ */
+
+void bin32_hex(long val, char *hex)
+{
+    bin16_hex(val >> 16, hex);
+    bin16_hex(val, hex + 4);
+}
+
+/******************************************************************************
+ *
+ *  Convert ASCII decimal digits to 32-bit binary
+ *  Stops on first non-decimal character
+ *
+ *  in:  string, pointer for end of number (may be null)
+ *  out: binary
+ */
+
+unsigned long dec_bin32(char *dec, char **end)
+{
+    unsigned long	 val;
+    char		 dig;
+
+    val = 0;
+    while (1) {
+	dig = *dec - '0';
+	if ((unsigned char)dig > 9)
+	    break;
+	val = (val << 3) + (val << 1) + dig;
+	dec++;
+    }
+    if (end)
+	*end = dec;
+    return val;
+}
+
+/******************************************************************************
+ *
+ *  Get value of ASCII hex digit
+ *  out: 0-15, or 0xff if not hex
+ */
+
+static unsigned char hex_digit(char c)
+{
+    if (c >= '0' && c <= '9')
+	return c - '0';
+    c |= 0x20;			/* lower case */
+    if (c >= 'a' && c <= 'f')
+	return c - 'a' + 10;
+    return 0xff;
+}
+
+/******************************************************************************
+ *
+ *  Convert ASCII hex digits to 16-bit binary
+ *  Stops on first non-hex character
+ *
+ *  in:  string, pointer for end of number (may be null)
+ *  out: binary
+ */
+
+unsigned short hex_bin16(char *hex, char **end)
+{
+    unsigned short	 val;
+    unsigned char	 dig;
+
+    val = 0;
+    while ((dig = hex_digit(*hex)) != 0xff) {
+	val = (val << 4) | dig;
+	hex++;
+    }
+    if (end)
+	*end = hex;
+    return val;
+}
+
+/******************************************************************************
+ *
+ *  Convert ASCII hex digits to 32-bit binary
+ *  Stops on first non-hex character
+ *
+ *  in:  string, pointer for end of number (may be null)
+ *  out: binary
+ */
+
+unsigned long hex_bin32(char *hex, char **end)
+{
+    unsigned long	 val;
+    unsigned char	 dig;
+
+    val = 0;
+    while ((dig = hex_digit(*hex)) != 0xff) {
+	val = (val << 4) | dig;
+	hex++;
+    }
+    if (end)
+	*end = hex;
+    return val;
+}
@@ -1,13 +1,13 @@
 /*
  *  File name:  lib_bindec.h
  *  Date first: 12/24/2017
- *  Date last:  12/18/2018
+ *  Date last:  10/19/2026
  *
  *  Description: Library of binary/decimal functions for STM8
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2017, 2018 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2017, 2018, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
@@ -51,6 +51,18 @@ char *bin16_dec_rlz(short, char *);
 
 void bin8_hex(char, char *);
 
+/*
+ *  Convert 16 bit binary to 4 hex digits, terminate with zero
+ */
+
+void bin16_hex(short, char *);
+
+/*
+ *  Convert 32 bit binary to 8 hex digits, terminate with zero
+ */
+
+void bin32_hex(long, char *);
+
 /*
  *  Convert ASCII decimal digits to 16-bit binary
  *  Stops on first non-decimal character
@@ -64,3 +76,46 @@ int dec_bin16(char *);
  *  Stops on first non-decimal character
  */
 int dec_bin16s(char *);
+
+/*
+ *  Convert ASCII decimal digits to 32-bit binary
+ *  Stops on first non-decimal character
+ *  in: string, pointer for end of number (may be null)
+ */
+
+unsigned long dec_bin32(char *, char **);
+
+/*
+ *  Convert ASCII hex digits to 16 or 32-bit binary
+ *  Stops on first non-hex character
+ *  in: string, pointer for end of number (may be null)
+ */
+
+unsigned short hex_bin16(char *, char **);
+unsigned long hex_bin32(char *, char **);
+
+/*
+ *  Format signed fixed point binary as decimal, eg "-12.25"
+ *  in:  value, fraction bits (0-12), decimal places (0-4), 12 char buffer
+ *  out: string length
+ *  Fraction is truncated, not rounded
+ */
+
+char fix16_dec(short, char, char, char *);
+
+/*
+ *  Format signed value scaled by a power of ten, eg 1225 -> "12.25"
+ *  in:  value, decimal places (0-4), 8 char buffer
+ *  out: string length
+ */
+
+char scaled_dec(short, char, char *);
+
+/*
+ *  Convert ASCII decimal with optional sign and fraction, eg "-12.25",
+ *  to signed fixed point binary
+ *  in:  string, fraction bits (0-12)
+ *  Stops on first character that is not part of the number
+ */
+
+short dec_fix16(char *, char);
@@ -1,13 +1,13 @@
 /*
  *  File name:  lib_board.c
  *  Date first: 07/01/2019
- *  Date last:  07/01/2019
+ *  Date last:  10/19/2026
  *
  *  Description: STM8 Library for popular board support (stm8s103F3, stm8s105).
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2019 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2019, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
@@ -103,3 +103,36 @@ void board_led(char on)
 #endif
 }
 
+/******************************************************************************
+ *
+ *  Disable interrupts, saving previous state
+ *  out: condition code for irq_restore()
+ */
+#pragma disable_warning 59
+
+char irq_save(void)
+{
+__ASM
+    push	cc
+    pop		a
+    sim
+__ENDASM
+}
+
+/******************************************************************************
+ *
+ *  Restore interrupt state saved by irq_save()
+ *  in: condition code
+ */
+
+void irq_restore(char cc)
+{
+    cc;
+__ASM
+#if defined(__SDCC) && __SDCCCALL == 0
+    ld		a, (3, sp)
+#endif
+    push	a
+    pop		cc
+__ENDASM
+}
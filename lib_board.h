@@ -1,13 +1,13 @@
 /*
  *  File name:  lib_board.h
  *  Date first: 07/01/2019
- *  Date last:  07/01/2019
+ *  Date last:  10/19/2026
  *
  *  Description: STM8 Library for popular board support (stm8s103, stm8s105).
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2019 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2019, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
@@ -26,3 +26,15 @@ void board_init(char freq);
  */
 
 void board_led(char on);
+
+/*
+ *  Disable interrupts for a short critical section, and restore the
+ *  previous state after. Safe to nest, and to use from interrupts.
+ *
+ *  cc = irq_save();
+ *  ...
+ *  irq_restore(cc);
+ */
+
+char irq_save(void);
+void irq_restore(char);
@@ -1,13 +1,13 @@
 /*
  *  File name:  lib_cli.c
  *  Date first: 02/19/2018
- *  Date last:  02/23/2018
+ *  Date last:  10/19/2026
  *
  *  Description: STM8 Library for handling commands from input source.
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2018 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2018, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
@@ -15,47 +15,54 @@
  */
 
 #include "lib_cli.h"
+#include "lib_bindec.h"
 
 #define CMD_CR		0x0d
 #define	CMD_BELL	0x07
 #define CMD_BS		0x08
 #define CMD_CRLF	"\r\n"
-
+#define CMD_STX		0x02
+
+static COMMAND_TAB *cli_lookup(COMMAND_CTX *, char *);
+static signed char cli_args(char *, char, char **, CLI_ARG *);
+static void	cli_error(COMMAND_CTX *, char, char);
+#ifdef CLI_BINARY
+static void	cli_frame_byte(COMMAND_CTX *, char);
+static void	cli_frame(COMMAND_CTX *);
+static void	cli_frame_reply(COMMAND_CTX *, char);
+static char	cli_frame_args(char *, char *, char, CLI_ARG *, char *);
+static char	crc8(char, char);
+#endif
+
+#ifdef CLI_SORTED
+static signed char keycmp(char *, char *);
+#else
 static char	cmpkey(char *, char *);	/* compare keyword */
+#endif
 static char	toupper(char);
 static char	tolower(char);
 
-static COMMAND_TAB *command_tab;
-static char	    command_len;
-static char	*buf_in;
-static char	 buf_len;
-
-static char	*cmd_ptr;
-static char	 cmd_len;
-
-static char	(*getc)(void);
-static void	(*putc)(char);
-static char	(*rxct)(void);
+static COMMAND_CTX *cli_ctx;	/* context for functions without one */
 
 /******************************************************************************
  *
  *  Command init
- *  in: COMMAND_TAB, tab size, command buffer, buffer size
+ *  in: COMMAND_CTX with table, buffer and char functions filled in
+ *
+ *  The context is used in place and must stay valid. The last context
+ *  initialized is used by the functions without a context argument.
  */
 
 void cli_init(COMMAND_CTX *ctx)
 {
-    command_tab = ctx->tab;
-    buf_in  = ctx->buf_in;
-    buf_len = ctx->buf_len - 1;
+    COMMAND_TAB *tab;
 
-    getc = ctx->getc;
-    putc = ctx->putc;
-    rxct = ctx->size;
+    ctx->tab_len = 0;
+    for (tab = ctx->tab; tab->cmd_num; tab++)
+	ctx->tab_len++;
 
-    cmd_ptr = buf_in;
-    cmd_len = 0;
-    *cmd_ptr = 0;
+    cli_reset_ctx(ctx);
+    cli_ctx = ctx;
 }
 
 /******************************************************************************
@@ -64,34 +71,44 @@ void cli_init(COMMAND_CTX *ctx)
  *  out: non-zero = line ready
  */
 
-char cli_poll(void)
+char cli_poll_ctx(COMMAND_CTX *ctx)
 {
     char	cmdchr;
 
-    while (rxct()) {
-	cmdchr = getc();
+    while (ctx->size()) {
+	cmdchr = ctx->getc();
+#ifdef CLI_BINARY
+	if (ctx->frame) {
+	    cli_frame_byte(ctx, cmdchr);
+	    continue;
+	}
+	if (cmdchr == CMD_STX && !ctx->cmd_len) {
+	    ctx->frame = 1;
+	    continue;
+	}
+#endif
 	if (cmdchr == CMD_CR)
 	    return 1;
 	if (cmdchr == CMD_BS) {
-	    if (!cmd_len)
+	    if (!ctx->cmd_len)
 		continue;
-	    cmd_len--;
-	    cmd_ptr--;
-	    *cmd_ptr = 0;
-	    putc(CMD_BS);
-	    putc(' ');
-	    putc(CMD_BS);
+	    ctx->cmd_len--;
+	    ctx->cmd_ptr--;
+	    *ctx->cmd_ptr = 0;
+	    ctx->putc(CMD_BS);
+	    ctx->putc(' ');
+	    ctx->putc(CMD_BS);
 	    continue;
 	}
-	if (cmd_len == buf_len) {
-	    putc(CMD_BELL);
+	if (ctx->cmd_len == ctx->buf_len - 1) {
+	    ctx->putc(CMD_BELL);
 	    continue;
 	}
-	putc(cmdchr);
-	*cmd_ptr = cmdchr;
-	cmd_len++;
-	cmd_ptr++;
-	*cmd_ptr = 0;
+	ctx->putc(cmdchr);
+	*ctx->cmd_ptr = cmdchr;
+	ctx->cmd_len++;
+	ctx->cmd_ptr++;
+	*ctx->cmd_ptr = 0;
     }
     return 0;
 }
@@ -102,41 +119,122 @@ char cli_poll(void)
  *  out: command number or zero (invalid)
  */
 
-char cli_keynum(char *str)
+char cli_keynum_ctx(COMMAND_CTX *ctx, char *str)
+{
+    COMMAND_TAB *tab;
+
+    tab = cli_lookup(ctx, str);
+    return tab ? tab->cmd_num : 0;
+}
+
+/******************************************************************************
+ *
+ *  Find table entry for keyword
+ *  out: entry or NULL
+ */
+
+#ifndef CLI_SORTED
+static COMMAND_TAB *cli_lookup(COMMAND_CTX *ctx, char *str)
 {
     COMMAND_TAB *tab;
 
-    tab = command_tab;
+    tab = ctx->tab;
     while (tab->cmd_num) {
 	if (cmpkey(str, tab->cmd_name) == 0)
-	    return tab->cmd_num;
+	    return tab;
 	tab++;
     }
     return 0;
 }
 
+#else
+/*
+ *  Sorted table: binary search for the first name not below the input.
+ *  That is either an exact match, or the only name starting with the
+ *  input if the following name does not also start with it.
+ */
+
+static COMMAND_TAB *cli_lookup(COMMAND_CTX *ctx, char *str)
+{
+    COMMAND_TAB *tab;
+    unsigned char lo, hi, mid;
+
+    if (!*str)
+	return 0;
+
+    lo = 0;
+    hi = ctx->tab_len;
+    while (lo < hi) {
+	mid = (lo + hi) >> 1;
+	if (keycmp(str, ctx->tab[mid].cmd_name) > 0)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    if (lo == ctx->tab_len)
+	return 0;
+
+    tab = ctx->tab + lo;
+    switch (keycmp(str, tab->cmd_name)) {
+    case 0:			/* exact */
+	return tab;
+    case -1:			/* input is a prefix */
+	if (lo + 1 < ctx->tab_len && keycmp(str, tab[1].cmd_name) == -1)
+	    return 0;		/* ambiguous */
+	return tab;
+    }
+    return 0;
+}
+
+/******************************************************************************
+ *
+ *  Compare input (upper/lower) with table name (lowercase)
+ *  out: zero = match, -1 = input is prefix of name,
+ *       else negative if input sorts before name, positive if after
+ */
+
+static signed char keycmp(char *in, char *name)
+{
+    char	c;
+
+    while (1) {
+	c = *in++;
+	if (c >= 'A' && c <= 'Z')
+	    c += 0x20;
+	if (c != *name) {
+	    if (!c)
+		return -1;
+	    return (unsigned char)c < (unsigned char)*name ? -2 : 1;
+	}
+	if (!c)
+	    return 0;
+	name++;
+    }
+}
+#endif	/* CLI_SORTED */
+
 /******************************************************************************
  *
  *  Show available commands
  */
 
-static void puts(char *str)
+static void ctx_puts(COMMAND_CTX *ctx, char *str)
 {
     while (*str)
-	putc(*str++);
+	ctx->putc(*str++);
 }
 
-void cli_help(void)
+void cli_help_ctx(COMMAND_CTX *ctx)
 {
     COMMAND_TAB *tab;
 
-    tab = command_tab;
+    tab = ctx->tab;
     while (tab->cmd_num) {
-	puts(tab->cmd_name);
-	putc(9);
-	puts(tab->cmd_info);
-	putc(0x0d);
-	putc(0x0a);
+	ctx_puts(ctx, tab->cmd_name);
+	ctx->putc(9);
+	ctx_puts(ctx, tab->cmd_info);
+	ctx->putc(0x0d);
+	ctx->putc(0x0a);
 
 	tab++;
     }
@@ -147,11 +245,407 @@ void cli_help(void)
  *  Reset command line
  */
 
+void cli_reset_ctx(COMMAND_CTX *ctx)
+{
+    ctx->cmd_ptr = ctx->buf_in;
+    ctx->cmd_len = 0;
+    *ctx->cmd_ptr = 0;
+#ifdef CLI_BINARY
+    ctx->frame = 0;
+    ctx->reply_len = 0;
+#endif
+}
+
+/******************************************************************************
+ *
+ *  Run command line through its COMMAND_TAB handler
+ *  in:  context, command line (modified)
+ *  out: zero = ok or empty line, else CLI_ERR_* or handler error
+ */
+
+char cli_dispatch(COMMAND_CTX *ctx, char *line)
+{
+    COMMAND_TAB *tab;
+    char	*tok[CLI_ARGS_MAX + 2];
+    CLI_ARG	 arg[CLI_ARGS_MAX];
+    signed char	 argc;
+    signed char	 bad;
+    char	 err;
+
+    cli_trim(line);
+    argc = cli_tokenize(line, tok, CLI_ARGS_MAX + 2) - 1;
+    if (argc < 0)
+	return 0;
+
+    bad = 0;
+    tab = cli_lookup(ctx, tok[0]);
+    if (!tab || !tab->cmd_func)
+	err = CLI_ERR_CMD;
+    else {
+	bad = cli_args(tab->cmd_args, argc, tok + 1, arg);
+	if (bad < 0)
+	    err = CLI_ERR_ARGC;
+	else if (bad)
+	    err = CLI_ERR_VALUE;
+	else
+	    err = tab->cmd_func(ctx, argc, arg);
+    }
+#ifdef CLI_BINARY
+    ctx->reply_len = 0;		/* binary reply data not used here */
+#endif
+    if (err)
+	cli_error(ctx, err, bad);
+    return err;
+}
+
+/******************************************************************************
+ *
+ *  Reply with error, "ERR <n> <text>"
+ *  in: context, error number, bad argument number for CLI_ERR_VALUE
+ */
+
+static char *const cli_errtext[] = {
+    "unknown command", "missing or too many arguments", "bad argument ",
+    "bad frame", "line too long"
+};
+
+static void cli_error(COMMAND_CTX *ctx, char err, char argn)
+{
+    char	num[6];
+
+    ctx_puts(ctx, "ERR ");
+    ctx_puts(ctx, bin16_dec_rlz(err, num));
+    if (err <= CLI_ERR_LINE) {
+	ctx->putc(' ');
+	ctx_puts(ctx, cli_errtext[err - 1]);
+	if (err == CLI_ERR_VALUE)
+	    ctx->putc('0' + argn);
+    }
+    ctx_puts(ctx, CMD_CRLF);
+}
+
+/******************************************************************************
+ *
+ *  Convert argument tokens from signature
+ *  in:  signature (or NULL for none), token count, tokens, values out
+ *  out: zero = ok, -1 = wrong count, else number of first bad argument
+ */
+
+static signed char cli_args(char *sig, char argc, char **tok, CLI_ARG *arg)
+{
+    unsigned long val;
+    char	*end;
+    char	*str;
+    char	 type;
+    char	 neg;
+    char	 i;
+
+    if (!sig)
+	sig = "";
+
+    for (i = 0; i < argc; i++) {
+	type = sig[i];
+	if (!type || i == CLI_ARGS_MAX)
+	    return -1;			/* too many */
+	type |= 0x20;			/* lower case */
+	str = tok[i];
+	if (type == 's') {
+	    arg[i].s = str;
+	    continue;
+	}
+	neg = 0;
+	if (type == 'd' && *str == '-') {
+	    neg = 1;
+	    str++;
+	}
+	if (type == 'x')
+	    val = hex_bin32(str, &end);
+	else
+	    val = dec_bin32(str, &end);
+	if (end == str || *end || end - str > 8)
+	    return i + 1;		/* not a number, or too long */
+
+	switch (type) {
+	case 'd':
+	    if (val > 32767 + neg)
+		return i + 1;
+	    arg[i].i = neg ? -(int)val : (int)val;
+	    break;
+	case 'b':
+	    if (val > 255)
+		return i + 1;
+	    arg[i].b = val;
+	    break;
+	default:			/* 'u' and 'x' */
+	    if (val > 65535)
+		return i + 1;
+	    arg[i].u = val;
+	}
+    }
+    type = sig[i];
+    if (type >= 'a' && type <= 'z')
+	return -1;			/* missing */
+    return 0;
+}
+
+/******************************************************************************
+ *
+ *  Run command script, eg from EEPROM
+ *
+ *  Lines end with LF (CR is ignored), script ends with zero or size.
+ *  Text after '#' is a comment. Each line goes through cli_dispatch(),
+ *  errors are followed by "line <n>". The command buffer is used for
+ *  each line and reset at the end.
+ *
+ *  in:  context, script, maximum size
+ *  out: line number of first error, zero = all ok
+ */
+
+short cli_script_run(COMMAND_CTX *ctx, char *script, short size)
+{
+    char	*buf;
+    char	 len;
+    char	 over;
+    char	 err;
+    char	 c;
+    short	 line;
+    short	 first;
+    char	 num[6];
+
+    buf = ctx->buf_in;
+    line = 0;
+    first = 0;
+    while (size && *script) {
+	line++;
+	len = 0;
+	over = 0;
+	while (size) {
+	    c = *script;
+	    if (!c)
+		break;
+	    script++;
+	    size--;
+	    if (c == '\n')
+		break;
+	    if (c == '\r')
+		continue;
+	    if (len == ctx->buf_len - 1)
+		over = 1;
+	    else
+		buf[len++] = c;
+	}
+	buf[len] = 0;
+
+	if (over) {
+	    err = CLI_ERR_LINE;
+	    cli_error(ctx, err, 0);
+	}
+	else {
+	    cli_comment(buf, "####");
+	    err = cli_dispatch(ctx, buf);
+	}
+	if (err) {
+	    ctx_puts(ctx, "line ");
+	    ctx_puts(ctx, bin16_dec_rlz(line, num));
+	    ctx_puts(ctx, CMD_CRLF);
+	    if (!first)
+		first = line;
+	}
+    }
+    cli_reset_ctx(ctx);
+    return first;
+}
+
+#ifdef CLI_BINARY
+/******************************************************************************
+ *
+ *  Collect binary frame byte, run frame when complete
+ *  in: context, received byte
+ */
+
+static void cli_frame_byte(COMMAND_CTX *ctx, char c)
+{
+    unsigned char len;
+
+    *ctx->cmd_ptr++ = c;
+    ctx->cmd_len++;
+
+    len = ctx->buf_in[0];
+    if (ctx->cmd_len == 1) {
+	if (!len || len + 2 > ctx->buf_len) {
+	    cli_frame_reply(ctx, CLI_ERR_FRAME);
+	    cli_reset_ctx(ctx);
+	}
+	return;
+    }
+    if (ctx->cmd_len < len + 2)
+	return;
+
+    cli_frame(ctx);
+    cli_reset_ctx(ctx);
+}
+
+/******************************************************************************
+ *
+ *  Check binary frame and run its handler
+ */
+
+static void cli_frame(COMMAND_CTX *ctx)
+{
+    COMMAND_TAB *tab;
+    CLI_ARG	 arg[CLI_ARGS_MAX];
+    char	*buf;
+    char	 len;
+    char	 crc;
+    char	 argc;
+    char	 err;
+    char	 i;
+
+    buf = ctx->buf_in;
+    len = buf[0];
+    crc = 0;
+    for (i = 0; i <= len; i++)
+	crc = crc8(crc, buf[i]);
+
+    if (crc != buf[len + 1]) {
+	cli_frame_reply(ctx, CLI_ERR_FRAME);
+	return;
+    }
+    for (tab = ctx->tab; tab->cmd_num; tab++)
+	if (tab->cmd_num == buf[1])
+	    break;
+
+    if (!tab->cmd_num || !tab->cmd_func)
+	err = CLI_ERR_CMD;
+    else {
+	err = cli_frame_args(tab->cmd_args, buf + 2, len - 1, arg, &argc);
+	if (!err)
+	    err = tab->cmd_func(ctx, argc, arg);
+    }
+    cli_frame_reply(ctx, err);
+}
+
+/******************************************************************************
+ *
+ *  Convert binary frame arguments from signature
+ *  in:  signature (or NULL), argument bytes, byte count, values out,
+ *       argument count out
+ *  out: zero = ok, else CLI_ERR_ARGC or CLI_ERR_VALUE
+ */
+
+static char cli_frame_args(char *sig, char *data, char len,
+			   CLI_ARG *arg, char *argc)
+{
+    char	type;
+    char	n;
+
+    if (!sig)
+	sig = "";
+
+    n = 0;
+    while (len) {
+	type = sig[n];
+	if (!type || n == CLI_ARGS_MAX)
+	    return CLI_ERR_ARGC;	/* too many */
+	type |= 0x20;
+
+	if (type == 's') {
+	    arg[n].s = data;
+	    while (len && *data) {
+		data++;
+		len--;
+	    }
+	    if (!len)
+		return CLI_ERR_VALUE;	/* not terminated */
+	}
+	else if (type == 'b')
+	    arg[n].b = *data;
+	else {
+	    if (len < 2)
+		return CLI_ERR_ARGC;
+	    arg[n].u = (*data << 8) | (unsigned char)data[1];
+	    data++;
+	    len--;
+	}
+	data++;
+	len--;
+	n++;
+    }
+    *argc = n;
+    type = sig[n];
+    if (type >= 'a' && type <= 'z')
+	return CLI_ERR_ARGC;		/* missing */
+    return 0;
+}
+
+/******************************************************************************
+ *
+ *  Send binary reply frame with status and any handler reply data
+ */
+
+static void cli_frame_reply(COMMAND_CTX *ctx, char status)
+{
+    char	len;
+    char	crc;
+    char	i;
+
+    len = ctx->reply_len + 1;
+    ctx->putc(CMD_STX);
+    ctx->putc(len);
+    ctx->putc(status);
+    crc = crc8(crc8(0, len), status);
+    for (i = 1; i < len; i++) {
+	ctx->putc(ctx->reply[i - 1]);
+	crc = crc8(crc, ctx->reply[i - 1]);
+    }
+    ctx->putc(crc);
+}
+
+/******************************************************************************
+ *
+ *  CRC-8, polynomial 0x07
+ *  in:  CRC so far, byte
+ *  out: new CRC
+ */
+
+static char crc8(char crc, char c)
+{
+    char	i;
+
+    crc ^= c;
+    for (i = 0; i < 8; i++) {
+	if (crc & 0x80)
+	    crc = (crc << 1) ^ 0x07;
+	else
+	    crc <<= 1;
+    }
+    return crc;
+}
+#endif	/* CLI_BINARY */
+
+/******************************************************************************
+ *
+ *  Functions for a single command line, using the context from cli_init()
+ */
+
+char cli_poll(void)
+{
+    return cli_poll_ctx(cli_ctx);
+}
+
+char cli_keynum(char *str)
+{
+    return cli_keynum_ctx(cli_ctx, str);
+}
+
+void cli_help(void)
+{
+    cli_help_ctx(cli_ctx);
+}
+
 void cli_reset(void)
 {
-    cmd_ptr = buf_in;
-    cmd_len = 0;
-    *cmd_ptr = 0;
+    cli_reset_ctx(cli_ctx);
 }
 
 /******************************************************************************
@@ -356,6 +850,7 @@ __asm
 __endasm;
 }
 
+#ifndef CLI_SORTED
 /******************************************************************************
  *
  *  Compare keywords
@@ -382,3 +877,4 @@ __asm
 00090$:
 __endasm;
 }
+#endif
@@ -1,48 +1,117 @@
 /*
  *  File name:  lib_cli.h
  *  Date first: 02/19/2018
- *  Date last:  03/23/2018
+ *  Date last:  10/19/2026
  *
  *  Description: STM8 Library for handling commands from input source.
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2018 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2018, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
  *
+ *  Option for large command tables: binary search and unique prefix
+ *  matching (eg, "stat" for "status"). COMMAND_TAB must then be sorted
+ *  by cmd_name in ASCII order, with names in lowercase.
+ */
+
+//#define CLI_SORTED
+
+/*
+ *  Option for binary command frames from machine clients, see
+ *  cli_poll_ctx(). Comment out to save code space.
+ */
+
+//#define CLI_BINARY
+
+/*
+ *  Converted command arguments for handlers, see cmd_args below
+ */
+
+typedef union {
+    int			 i;	/* 'd' signed decimal */
+    unsigned int	 u;	/* 'u' unsigned decimal, 'x' hex */
+    unsigned char	 b;	/* 'b' decimal 0-255 */
+    char		*s;	/* 's' string token */
+} CLI_ARG;
+
+#define CLI_ARGS_MAX	6
+
+/*
  *  Command structure
+ *
+ *  cmd_func and cmd_args are optional, for cli_dispatch(). cmd_args
+ *  has one char per argument (up to CLI_ARGS_MAX): 'd', 'u', 'x', 'b'
+ *  or 's' as above. Upper case means optional (all following must be
+ *  optional too), eg "uX" is an unsigned and an optional hex value.
+ *  The handler gets the number of arguments given and the converted
+ *  values, and returns zero or an error number (CLI_ERR_USER or above,
+ *  lower numbers are library errors) for the reply.
  */
 
+struct command_ctx;
+
 typedef struct {
     char	 cmd_num;	/* up to 255 commands */
     char	*cmd_name;	/* case insensitive */
     char	*cmd_info;	/* command help or NULL */
+    char (*cmd_func)(struct command_ctx *, char, CLI_ARG *);
+    char	*cmd_args;	/* argument signature or NULL */
 } COMMAND_TAB;
 
-typedef struct {
+typedef struct command_ctx {
     COMMAND_TAB *tab;		/* command table */
     char	*buf_in;	/* input buffer */
     char	 buf_len;
     char (*getc)(void);		/* char get function */
     void (*putc)(char);		/* char put function */
     char (*size)(void);		/* rx buf count */
+
+    char	*cmd_ptr;	/* set by cli_init() */
+    char	 cmd_len;
+    unsigned char tab_len;
+#ifdef CLI_BINARY
+    char	 frame;		/* non-zero = receiving binary frame */
+    char	*reply;		/* binary reply data, set by handler */
+    char	 reply_len;
+#endif
 } COMMAND_CTX;
 
 /*
  *  Command init
- *  in: COMMAND_TAB, tab size, command buffer, buffer size
+ *  in: COMMAND_CTX with table, buffer and char functions filled in
+ *
+ *  Each command line (eg, UART and another transport) has its own
+ *  COMMAND_CTX, used in place by the *_ctx functions below. The
+ *  functions without a context use the last one initialized.
  */
 
 void cli_init(COMMAND_CTX *);
 
 /*
- *  Poll UART for command characters
+ *  Poll input source for command characters
  *  out: non-zero = line ready
+ *
+ *  With CLI_BINARY, STX (0x02) at the start of a line begins a binary
+ *  frame, which is not echoed and is handled here:
+ *
+ *    STX, length, command number, arguments, CRC
+ *
+ *  Length counts the command number and arguments. The CRC is CRC-8
+ *  (polynomial 0x07, initial zero) of the length through arguments.
+ *  Arguments follow cmd_args: 'b' one byte, 'd' 'u' 'x' two bytes
+ *  high first, 's' zero terminated. The reply frame is
+ *
+ *    STX, length, status, reply data, CRC
+ *
+ *  where status is zero or a CLI_ERR_* or handler error. A handler may
+ *  point ctx->reply at up to 254 bytes and set ctx->reply_len.
  */
 
 char cli_poll(void);
+char cli_poll_ctx(COMMAND_CTX *);
 
 /*
  *  Get command number
@@ -50,12 +119,14 @@ char cli_poll(void);
  */
 
 char cli_keynum(char *);
+char cli_keynum_ctx(COMMAND_CTX *, char *);
 
 /*
  *  Reset command line
  */
 
 void cli_reset(void);
+void cli_reset_ctx(COMMAND_CTX *);
 
 /*
  *  Remove comment from string (comment char inside double quotes ignored)
@@ -93,3 +164,38 @@ char cli_tokenize(char *, char **, char);
  */
 
 void cli_help(void);
+void cli_help_ctx(COMMAND_CTX *);
+
+/*
+ *  Run command line through its COMMAND_TAB handler
+ *
+ *  Trims and tokenizes the line in place, converts and range checks
+ *  arguments from cmd_args, then calls cmd_func. Errors are replied
+ *  as "ERR <n> <text>", eg "ERR 3 bad argument 2".
+ *
+ *  in:  context, command line
+ *  out: zero = ok or empty line, else CLI_ERR_* or handler error
+ */
+
+#define CLI_ERR_CMD	1	/* unknown command, or no handler */
+#define CLI_ERR_ARGC	2	/* missing or too many arguments */
+#define CLI_ERR_VALUE	3	/* argument not a number, or out of range */
+#define CLI_ERR_FRAME	4	/* binary frame length or CRC error */
+#define CLI_ERR_LINE	5	/* script line longer than command buffer */
+#define CLI_ERR_USER	16	/* first handler error number */
+
+char cli_dispatch(COMMAND_CTX *, char *);
+
+/*
+ *  Run command script, eg stored in EEPROM with eeprom_write()
+ *
+ *  Lines end with LF, the script with zero or size. Text after '#' is a
+ *  comment. Each line goes through cli_dispatch(), and errors are
+ *  followed by "line <n>". A line that does not fit the command buffer
+ *  is not run (CLI_ERR_LINE). Uses and resets the command buffer.
+ *
+ *  in:  context, script, maximum size
+ *  out: line number of first error, zero = all ok
+ */
+
+short cli_script_run(COMMAND_CTX *, char *, short);
@@ -1,13 +1,13 @@
 /*
  *  File name:  lib_clock.c
  *  Date first: 03/23/2018
- *  Date last:  04/18/2018
+ *  Date last:  10/19/2026
  *
  *  Description: Library for maintaining a wall clock using timer 4
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2018 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2018, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
@@ -17,7 +17,9 @@
 #include "stm8s_header.h"
 
 #include "lib_bindec.h"
+#include "lib_board.h"
 #include "lib_clock.h"
+#include "lib_prof.h"
 
 static signed char clock_ms;	/* milliseconds, may be negative with trim */
 static char clock_tenths;	/* clock tenths: 0-9 */
@@ -27,8 +29,16 @@ static char clock_hours;	/* clock hours:   0-23 */
 static char clock_days;		/* clock days:   0-255 */
 
 static signed char trim_second;	/* small trim every second */
+static short trim_ppm;		/* ppm trim, 1/16 ppm units */
+static short trim_phase;	/* ppm trim accumulator */
 
-static volatile char clock_lock;	/* lock to update clock */
+#ifdef CLOCK_PPS
+static long pps_sum;		/* sum of PPS errors, 1/16 ppm */
+static char pps_samples;
+#endif
+
+static unsigned long clock_epoch;	/* seconds since 2000-01-01 00:00:00 */
+static volatile unsigned char clock_seq; /* bumped on every clock change */
 
 #ifdef CLOCK_CALENDAR
 static CLOCK_CAL calendar;
@@ -37,6 +47,39 @@ static CLOCK_CAL calendar;
 static void (*timer_ms)(void);
 static void (*timer_10)(void);
 
+static void clock_second(void);
+static long clock_delta(char, char, char);
+
+#ifdef CLOCK_CALENDAR
+static void clock_sync(void);
+#endif
+
+#ifdef CLOCK_ALARM
+typedef struct {
+    char	hour;		/* 0-23 or CLOCK_ANY */
+    char	min;		/* 0-59 or CLOCK_ANY */
+    char	days;		/* weekday mask, zero = every day */
+    char	flags;		/* CLOCK_AL_* */
+    void (*func)(char);		/* callback or NULL */
+} CLOCK_AL;
+
+#define CLOCK_AL_ON	0x80	/* alarm in use */
+
+static CLOCK_AL alarms[CLOCK_ALARMS];
+static unsigned char alarm_secs;	/* alarms to check every second */
+static volatile unsigned char alarm_pending;
+
+static void clock_alarm_check(void);
+#endif
+
+#ifdef CLOCK_HALT
+static unsigned short clock_halt_slice(unsigned short);
+static void clock_advance(unsigned short);
+
+static volatile char awu_fired;	/* AWU interrupt seen */
+static unsigned char halt_frac;	/* halt time remainder, 1/128 ms */
+#endif
+
 /******************************************************************************
  *
  * Initialize the clock (set up timer 4)
@@ -45,6 +88,10 @@ static void (*timer_10)(void);
 
 void clock_init(void (*call_ms)(void), void (*call_10)(void))
 {
+#ifdef CLOCK_ALARM
+    char	ct;
+#endif
+
     timer_ms = call_ms;
     timer_10 = call_10;
 
@@ -54,9 +101,24 @@ void clock_init(void (*call_ms)(void), void (*call_10)(void))
     clock_mins   = 0;
     clock_hours  = 0;
     clock_days   = 0;
-    clock_lock   = 0;
+    clock_epoch  = 0;
+#ifdef CLOCK_CALENDAR
+    clock_sync();		/* 2000-01-01 */
+#endif
 
     trim_second = 0;		/* millisecond trim every second */
+    trim_ppm    = 0;
+    trim_phase  = 0;
+#ifdef CLOCK_ALARM
+    for (ct = 0; ct < CLOCK_ALARMS; ct++)
+	alarms[ct].flags = 0;
+    alarm_secs    = 0;
+    alarm_pending = 0;
+#endif
+#ifdef CLOCK_PPS
+    pps_sum     = 0;
+    pps_samples = 0;
+#endif
 
 #ifdef STM8103
     TIM4_PSCR = 6;	/* prescaler = 64 for 16mhz */
@@ -77,16 +139,22 @@ void clock_init(void (*call_ms)(void), void (*call_10)(void))
 
 void clock_string(char *buf)
 {
-    clock_lock = 1;
-    bin8_dec2(clock_hours, buf);
-    bin8_dec2(clock_mins,  buf + 3);
-    bin8_dec2(clock_secs,  buf + 6);
-    clock_lock = 0;
+    char	vals[4];
+
+    clock_bin_get(vals);
+    bin8_dec2(vals[1], buf);
+    bin8_dec2(vals[2], buf + 3);
+    bin8_dec2(vals[3], buf + 6);
     buf[2] = ':';
     buf[5] = ':';
 }
 
-/******************************************************************************
+/* The clock is only changed by the timer interrupt, which bumps clock_seq
+ * before it returns, and by the set functions with interrupts off. A reader
+ * copies what it needs and tries again if clock_seq moved meanwhile, so the
+ * interrupt never waits for a reader.
+ *
+ ******************************************************************************
  *
  *  Get binary values for day, hour, minute, second
  *  out: (4 bytes set)
@@ -94,28 +162,101 @@ void clock_string(char *buf)
 
 void clock_bin_get(char *vals)
 {
-    clock_lock = 1;
-    vals[0] = clock_days;
-    vals[1] = clock_hours;
-    vals[2] = clock_mins;
-    vals[3] = clock_secs;
-    clock_lock = 0;
+    unsigned char seq;
+
+    do {
+	seq = clock_seq;
+	vals[0] = clock_days;
+	vals[1] = clock_hours;
+	vals[2] = clock_mins;
+	vals[3] = clock_secs;
+    } while (seq != clock_seq);
 }
 
 /******************************************************************************
  *
  *  Set clock from binary values
- *  out: (4 bytes set)
+ *  The day count is a free running counter, and does not move the epoch
+ *  or calendar. Only the time of day change is applied to the epoch.
+ *  in: (4 bytes)
  */
 
 void clock_bin_set(char *vals)
 {
-    clock_lock = 1;
+    char	cc;
+
+    cc = irq_save();
+    clock_epoch += clock_delta(vals[1], vals[2], vals[3]);
     clock_days  = vals[0];
     clock_hours = vals[1];
     clock_mins  = vals[2];
     clock_secs  = vals[3];
-    clock_lock = 0;
+#ifdef CLOCK_CALENDAR
+    clock_sync();
+#endif
+    clock_seq++;
+    irq_restore(cc);
+}
+
+/******************************************************************************
+ *
+ *  Get seconds counter
+ *  out: seconds since 2000-01-01 00:00:00
+ */
+
+unsigned long clock_seconds(void)
+{
+    unsigned long secs;
+    unsigned char seq;
+
+    do {
+	seq = clock_seq;
+	secs = clock_epoch;
+    } while (seq != clock_seq);
+    return secs;
+}
+
+/******************************************************************************
+ *
+ *  Set seconds counter, and the time of day (and calendar) from it
+ *  The day count is left alone, as in clock_bin_set().
+ *  in: seconds since 2000-01-01 00:00:00
+ */
+
+void clock_seconds_set(unsigned long secs)
+{
+    unsigned short mins;
+    char	cc;
+
+    cc = irq_save();
+    clock_epoch = secs;
+    secs %= 86400;
+    mins = secs / 60;
+    clock_secs  = secs - mins * 60;
+    clock_hours = mins / 60;
+    clock_mins  = mins - clock_hours * 60;
+#ifdef CLOCK_CALENDAR
+    clock_sync();
+#endif
+    clock_seq++;
+    irq_restore(cc);
+}
+
+/******************************************************************************
+ *
+ *  Get seconds change for new time of day, to keep clock_epoch in step
+ *  in:  new hours, minutes, seconds
+ *  out: new minus current seconds
+ */
+
+static long clock_delta(char h, char m, char s)
+{
+    long	delta;
+
+    delta  = (long)((signed char)(h - clock_hours)) * 3600;
+    delta += (short)((signed char)(m - clock_mins)) * 60;
+    delta += (signed char)(s - clock_secs);
+    return delta;
 }
 
 /******************************************************************************
@@ -128,6 +269,7 @@ char clock_set(char *time)
 {
     char	*t;
     char	ct, h, m, s;
+    char	cc;
 
     t = time;
     ct = 0;
@@ -148,11 +290,16 @@ char clock_set(char *time)
 	(s > 59))
 	return 1;
 	    
-    clock_lock = 1;
+    cc = irq_save();
+    clock_epoch += clock_delta(h, m, s);
     clock_hours = h;
     clock_mins  = m;
     clock_secs  = s;
-    clock_lock = 0;
+#ifdef CLOCK_CALENDAR
+    clock_sync();
+#endif
+    clock_seq++;
+    irq_restore(cc);
     return 0;
 }
 
@@ -168,6 +315,74 @@ void clock_trim(signed char large, signed char fine)
     trim_second = fine;
 }
 
+/******************************************************************************
+ *
+ *  Set fractional clock trim
+ *
+ *  Every second the trim is added to a phase accumulator, and a tick is
+ *  added or dropped each time it passes one millisecond.
+ *
+ *  in: trim in 1/16 ppm (+/-16000 = 1000 ppm), positive speeds up
+ */
+
+void clock_trim_ppm(short ppm16)
+{
+    if (ppm16 > 16000)
+	ppm16 = 16000;
+    if (ppm16 < -16000)
+	ppm16 = -16000;
+    trim_ppm = ppm16;		/* 16 bit write, interrupt safe */
+}
+
+/******************************************************************************
+ *
+ *  Get fractional clock trim
+ *  out: trim in 1/16 ppm
+ */
+
+short clock_trim_get(void)
+{
+    return trim_ppm;
+}
+
+#ifdef CLOCK_PPS
+/******************************************************************************
+ *
+ *  Discipline clock from one PPS period
+ *
+ *  The period is counted at the CPU clock (timer 2 prescale 1), so only
+ *  the low 16 bits are known. The difference from the nominal low 16
+ *  bits is the CPU clock error, at 16 counts per ppm for 16 mhz. The
+ *  trim is set to the opposite of the average error over
+ *  CLOCK_PPS_AVG periods. Periods over CLOCK_PPS_LIMIT off (eg, a
+ *  missed pulse) are ignored.
+ *
+ *  in:  PPS period in CPU clocks (low 16 bits)
+ *  out: zero = sample added, 1 = sample rejected, 2 = trim updated
+ */
+
+char clock_pps(unsigned short period)
+{
+    short	err;
+
+    err = period - (unsigned short)(CLOCK_PPS_MHZ * 1000000L);
+    if (err > CLOCK_PPS_LIMIT * CLOCK_PPS_MHZ ||
+	err < CLOCK_PPS_LIMIT * -CLOCK_PPS_MHZ)
+	return 1;
+    err *= 16 / CLOCK_PPS_MHZ;	/* 1/16 ppm */
+
+    pps_sum += err;
+    pps_samples++;
+    if (pps_samples < CLOCK_PPS_AVG)
+	return 0;
+
+    clock_trim_ppm(-(short)(pps_sum / CLOCK_PPS_AVG));
+    pps_sum = 0;
+    pps_samples = 0;
+    return 2;
+}
+#endif
+
 /******************************************************************************
  *
  *  Timer 4 interrupt
@@ -175,46 +390,352 @@ void clock_trim(signed char large, signed char fine)
 
 void timer4_isr(void) __interrupt (IRQ_TIM4)
 {
+    PROF_ENTER(PROF_CLOCK);
     TIM4_SR = 0;		/* clear the interrupt */
 
     timer_ms();
     clock_ms++;
-    if (clock_lock)
-	return;
-    if (clock_ms < 100)
-	return;
-    clock_ms -= 100;
+    if (clock_ms >= 100) {
+	clock_ms -= 100;
+
+	timer_10();
+	clock_tenths++;
+	if (clock_tenths >= 10) {
+	    clock_tenths = 0;
+	    clock_second();
+	}
+    }
+    PROF_EXIT(PROF_CLOCK);
+}
 
-    timer_10();
-    clock_tenths++;
-    if (clock_tenths < 10)
-	return;
-    clock_tenths = 0;
+/******************************************************************************
+ *
+ *  Advance clock one second
+ */
 
+static void clock_second(void)
+{
+    clock_seq++;		/* readers will retry */
+    clock_epoch++;
     clock_ms += trim_second;
+    trim_phase += trim_ppm;	/* 16000 = 1 ms */
+    if (trim_phase >= 16000) {
+	trim_phase -= 16000;
+	clock_ms++;		/* add a tick */
+    }
+    else if (trim_phase <= -16000) {
+	trim_phase += 16000;
+	clock_ms--;		/* drop a tick */
+    }
     clock_secs++;
-    if (clock_secs < 60)
-	return;
-    clock_secs = 0;
-    clock_mins++;
-    if (clock_mins < 60)
-	return;
-    clock_mins = 0;
-    clock_hours++;
-    if (clock_hours < 24)
+    if (clock_secs >= 60) {
+	clock_secs = 0;
+	clock_mins++;
+	if (clock_mins >= 60) {
+	    clock_mins = 0;
+	    clock_hours++;
+	    if (clock_hours >= 24) {
+		clock_hours = 0;
+		clock_days++;
+#ifdef CLOCK_CALENDAR
+		clock_inc_calendar();
+#endif
+	    }
+	}
+    }
+#ifdef CLOCK_ALARM
+    if (alarm_secs || !clock_secs)
+	clock_alarm_check();
+#endif
+}
+
+#ifdef CLOCK_ALARM
+/******************************************************************************
+ *
+ *  Set alarm
+ *
+ *  Alarms match at the start of a minute (hh:mm:00), or every second
+ *  with CLOCK_AL_SEC. Only the second alarms are looked at until the
+ *  minute rolls over.
+ *
+ *  in:  alarm number, hour, minute, weekday mask, flags, callback
+ *  out: zero = ok
+ */
+
+char clock_alarm_set(char id, char hour, char min, char days, char flags,
+		     void (*func)(char))
+{
+    CLOCK_AL	*al;
+    char	cc;
+
+    if (id >= CLOCK_ALARMS)
+	return 1;
+    al = alarms + id;
+
+    cc = irq_save();
+    al->hour  = hour;
+    al->min   = min;
+    al->days  = days;
+    al->func  = func;
+    al->flags = flags | CLOCK_AL_ON;
+    if (flags & CLOCK_AL_SEC)
+	alarm_secs |= 1 << id;
+    else
+	alarm_secs &= ~(1 << id);
+    irq_restore(cc);
+    return 0;
+}
+
+/******************************************************************************
+ *
+ *  Clear alarm
+ *  in: alarm number
+ */
+
+void clock_alarm_clear(char id)
+{
+    char	cc;
+
+    if (id >= CLOCK_ALARMS)
 	return;
-    clock_hours = 0;
-    clock_days++;
-    
+    cc = irq_save();
+    alarms[id].flags = 0;
+    alarm_secs &= ~(1 << id);
+    alarm_pending &= ~(1 << id);
+    irq_restore(cc);
+}
+
+/******************************************************************************
+ *
+ *  Get and clear alarms fired since the last call
+ *  out: bit mask of alarm numbers
+ */
+
+unsigned char clock_alarm_pending(void)
+{
+    unsigned char pending;
+    char	cc;
+
+    cc = irq_save();
+    pending = alarm_pending;
+    alarm_pending = 0;
+    irq_restore(cc);
+    return pending;
+}
+
+/******************************************************************************
+ *
+ *  Check alarms, from the clock interrupt
+ *  Called every second if there are second alarms, else once a minute.
+ */
+
+static void clock_alarm_check(void)
+{
+    CLOCK_AL	*al;
+    unsigned char bit;
+    char	id;
+
+    al = alarms;
+    bit = 1;
+    for (id = 0; id < CLOCK_ALARMS; id++, al++, bit <<= 1) {
+	if (!(al->flags & CLOCK_AL_ON))
+	    continue;
+	if (!(al->flags & CLOCK_AL_SEC)) {
+	    if (clock_secs)
+		continue;
+	    if (al->min != CLOCK_ANY && al->min != clock_mins)
+		continue;
+	    if (al->hour != CLOCK_ANY && al->hour != clock_hours)
+		continue;
 #ifdef CLOCK_CALENDAR
-    clock_inc_calendar();
+	    if (al->days && !(al->days & (1 << (calendar.day - 1))))
+		continue;
 #endif
+	}
+	if (al->flags & CLOCK_AL_ONCE) {
+	    al->flags = 0;
+	    alarm_secs &= ~bit;
+	}
+	alarm_pending |= bit;
+	if (al->func)
+	    al->func(id);
+    }
+}
+#endif	/* CLOCK_ALARM */
+
+#ifdef CLOCK_HALT
+/******************************************************************************
+ *
+ *  Halt CPU in slices of up to CLOCK_HALT_SLICE ms, advancing the clock
+ *  after each one. Another interrupt ends the halt, and only the slice
+ *  it broke into is lost.
+ *
+ *  in:  maximum milliseconds to halt (up to 30720)
+ *  out: milliseconds the clock was advanced
+ */
+
+unsigned short clock_halt(unsigned short ms)
+{
+    unsigned short done;
+    unsigned short part;
+
+    if (ms > 30720)
+	ms = 30720;
+
+    done = 0;
+    while (ms) {
+	part = ms;
+	if (part > CLOCK_HALT_SLICE)
+	    part = CLOCK_HALT_SLICE;
+	part = clock_halt_slice(part);
+	if (!part)
+	    break;		/* other interrupt */
+	done += part;
+	if (part >= ms)
+	    break;
+	ms -= part;
+    }
+    return done;
+}
+
+/******************************************************************************
+ *
+ *  Halt CPU until auto wakeup, then advance the clock
+ *
+ *  The AWU runs from the 128 khz LSI, so wakeup intervals are in 1/128
+ *  ms. For time base 1-13 the interval is 2^(TB-1) * APRDIV counts, for
+ *  14 it is 5 * 2^11 * APRDIV, and for 15 it is 30 * 2^11 * APRDIV, with
+ *  APRDIV 2-64. The longest interval not over the request is used, and
+ *  the remainder is carried to the next halt.
+ *
+ *  in:  maximum milliseconds to halt (1 to 30720)
+ *  out: milliseconds the clock was advanced (zero if woken early)
+ */
+
+static unsigned short clock_halt_slice(unsigned short ms)
+{
+    unsigned long units;
+    unsigned char tb;
+    unsigned char div;
+
+    if (ms <= 2048) {
+	units = (unsigned long)ms << 7;
+	tb = 1;
+	while (units > 64) {
+	    units >>= 1;
+	    tb++;
+	}
+	div = units;
+	units <<= tb - 1;
+    }
+    else if (ms >= 5280) {
+	tb = 15;
+	div = ms / 480;
+	if (div > 64)
+	    div = 64;
+	units = (unsigned long)div * (30L << 11);
+    }
+    else if (ms >= 2080) {
+	tb = 14;
+	div = ms / 80;
+	if (div > 64)
+	    div = 64;
+	units = (unsigned long)div * (5L << 11);
+    }
+    else {
+	tb = 13;
+	div = 64;
+	units = 64L << 12;
+    }
+
+    CLK_ICKR |= 0x08;		/* LSI on */
+    while (!(CLK_ICKR & 0x10))
+	;
+    AWU_APR = div - 2;
+    AWU_TBR = tb;
+    awu_fired = 0;
+    AWU_CSR = 0x10;		/* AWUEN, halt becomes active halt */
+    __asm__ ("halt");
+    AWU_CSR = 0;
+    AWU_TBR = 0;
+
+    if (!awu_fired)
+	return 0;		/* other interrupt, time not known */
+
+    units += halt_frac;
+    halt_frac = units & 127;
+    ms = units >> 7;
+    clock_advance(ms);
+    return ms;
 }
 
+/******************************************************************************
+ *
+ *  Auto wakeup interrupt
+ */
+
+void clock_awu_isr(void) __interrupt (IRQ_AWU)
+{
+    awu_fired = AWU_CSR & 0x20;	/* read clears AWUF */
+}
+
+/******************************************************************************
+ *
+ *  Advance clock by milliseconds passed without ticks
+ *  The millisecond and 1/10 second callbacks are not called.
+ */
+
+static void clock_advance(unsigned short ms)
+{
+    short	total;
+    char	cc;
+
+    cc = irq_save();
+    total = clock_ms + ms;
+    while (total >= 100) {
+	total -= 100;
+	clock_tenths++;
+	if (clock_tenths < 10)
+	    continue;
+	clock_tenths = 0;
+	clock_ms = 0;
+	clock_second();		/* may apply trim to clock_ms */
+	total += clock_ms;
+    }
+    clock_ms = total;
+    irq_restore(cc);
+}
+#endif	/* CLOCK_HALT */
+
 #ifdef CLOCK_CALENDAR
 
 static const char days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
 
+/* Days before each month, non-leap year */
+static const short mdays_before[12] = {
+    0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+
+/* Days before each year of a 4 year block starting with a leap year */
+static const short ydays_before[4] = { 0, 366, 731, 1096 };
+
+#define DAY_2100_MAR1	36584	/* first day after the missing 2100 Feb 29 */
+
+/******************************************************************************
+ *
+ *  Check for leap year (Gregorian)
+ *  in:  year
+ *  out: non-zero = leap year
+ */
+
+static char clock_leap(int year)
+{
+    if (year & 3)
+	return 0;
+    if (year % 100)
+	return 1;
+    return (year % 400) == 0;
+}
+
 /******************************************************************************
  *
  *  Advance calendar one day
@@ -230,7 +751,7 @@ void clock_inc_calendar(void)
 
     mdays = days[calendar.month - 1];
     if (calendar.month == 2 &&
-	(calendar.year & 3) == 0)
+	clock_leap(calendar.year))
 	mdays++;
     calendar.date++;
     if (calendar.date <= mdays)
@@ -245,9 +766,93 @@ void clock_inc_calendar(void)
     calendar.year++;
 }
 
-/* NOTE: This function will normally be called from the timer interrupt, and
- * will be protected by "clock_lock". During testing, this may also be called
- * from user space and that code will need to avoid possible race condition.
+/******************************************************************************
+ *
+ *  Convert epoch seconds to calendar and time of day
+ *
+ *  The day count is bumped past the missing 2100 Feb 29, then every
+ *  4 year block is 1461 days starting with a leap year.
+ *
+ *  in: seconds since 2000-01-01 00:00:00, calendar, hours/mins/secs or NULL
+ */
+
+void clock_epoch_cal(unsigned long secs, CLOCK_CAL *cal, char *hms)
+{
+    unsigned short	day;
+    unsigned short	mins;
+    unsigned long	tod;
+    char		y, m;
+
+    day = secs / 86400;
+    if (hms) {
+	tod  = secs - (unsigned long)day * 86400;
+	mins = tod / 60;
+	hms[2] = tod - (unsigned long)mins * 60;
+	hms[0] = mins / 60;
+	hms[1] = mins - hms[0] * 60;
+    }
+    cal->day = (day + 5) % 7 + 1;	/* 2000-01-01 was Saturday */
+
+    if (day >= DAY_2100_MAR1)
+	day++;
+    cal->year = 2000 + (day / 1461) * 4;
+    day %= 1461;
+    y = 3;
+    while (day < ydays_before[y])
+	y--;
+    day -= ydays_before[y];
+    cal->year += y;
+
+    m = 11;
+    while (day < mdays_before[m] + (m > 1 && y == 0))
+	m--;
+    day -= mdays_before[m] + (m > 1 && y == 0);
+    cal->month = m + 1;
+    cal->date  = day + 1;
+}
+
+/******************************************************************************
+ *
+ *  Convert calendar and time of day to epoch seconds
+ *  The day of week is not used.
+ *
+ *  in:  calendar (2000-2135), hours/mins/secs or NULL for midnight
+ *  out: seconds since 2000-01-01 00:00:00
+ */
+
+unsigned long clock_cal_epoch(CLOCK_CAL *cal, char *hms)
+{
+    unsigned short	day;
+    unsigned long	secs;
+    char		y;
+
+    y = (cal->year - 2000) & 3;
+    day = (unsigned short)((cal->year - 2000) >> 2) * 1461 + ydays_before[y];
+    day += mdays_before[cal->month - 1] + cal->date - 1;
+    if (y == 0 && cal->month > 2)
+	day++;
+    if (day > DAY_2100_MAR1)
+	day--;
+
+    secs = (unsigned long)day * 86400;
+    if (hms)
+	secs += (unsigned short)(hms[0] * 60 + hms[1]) * 60L + hms[2];
+    return secs;
+}
+
+/******************************************************************************
+ *
+ *  Set calendar from clock_epoch, with interrupts off
+ */
+
+static void clock_sync(void)
+{
+    clock_epoch_cal(clock_epoch, &calendar, 0);
+}
+
+/* NOTE: clock_inc_calendar() is normally called from the timer interrupt.
+ * When called from user space for testing, it should be done with
+ * interrupts off (irq_save) and clock_seq will not be bumped.
  *
  ******************************************************************************
  *
@@ -257,28 +862,38 @@ void clock_inc_calendar(void)
 
 void clock_cal_get(CLOCK_CAL *cal)
 {
-    clock_lock = 1;
-    cal->year  = calendar.year;
-    cal->month = calendar.month;
-    cal->date  = calendar.date;
-    cal->day   = calendar.day;
-    clock_lock = 0;
+    unsigned char seq;
+
+    do {
+	seq = clock_seq;
+	cal->year  = calendar.year;
+	cal->month = calendar.month;
+	cal->date  = calendar.date;
+	cal->day   = calendar.day;
+    } while (seq != clock_seq);
 }
 
 /******************************************************************************
  *
- *  Set calendar data
+ *  Set calendar date, keeping the time of day
+ *  The day of week is set from the date.
+ *
  *  in: calendar structure
  */
 
 void clock_cal_set(CLOCK_CAL *cal)
 {
-    clock_lock = 1;
-    calendar.year  = cal->year;
-    calendar.month = cal->month;
-    calendar.date  = cal->date;
-    calendar.day   = cal->day;
-    clock_lock = 0;
+    char	hms[3];
+    char	cc;
+
+    cc = irq_save();
+    hms[0] = clock_hours;
+    hms[1] = clock_mins;
+    hms[2] = clock_secs;
+    clock_epoch = clock_cal_epoch(cal, hms);
+    clock_sync();
+    clock_seq++;
+    irq_restore(cc);
 }
 
 #endif	/* CLOCK_CALENDAR */
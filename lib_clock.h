@@ -1,13 +1,13 @@
 /*
  *  File name:  lib_clock.h
  *  Date first: 03/23/2018
- *  Date last:  08/16/2020
+ *  Date last:  10/19/2026
  *
  *  Description: Library for maintaining a wall clock using timer 4
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2018-2020 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2018-2020, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
@@ -18,6 +18,39 @@
 
 #define CLOCK_CALENDAR
 
+/*
+ *  Option for low power halt with auto wakeup (see clock_halt)
+ *  Comment out to save code and memory.
+ */
+
+//#define CLOCK_HALT
+
+#define CLOCK_HALT_SLICE 1024	/* ms, most time lost to an early wakeup */
+
+/*
+ *  Option to discipline the clock from a 1PPS input (see clock_pps)
+ *  Comment out to save code and memory.
+ */
+
+//#define CLOCK_PPS
+
+#ifdef STM8105
+#define CLOCK_PPS_MHZ	8	/* CPU clock, 1, 2, 4, 8 or 16 */
+#else
+#define CLOCK_PPS_MHZ	16
+#endif
+#define CLOCK_PPS_AVG	16	/* periods averaged per trim update */
+#define CLOCK_PPS_LIMIT	500	/* ppm, larger errors are ignored */
+
+/*
+ *  Option for alarms checked by the clock interrupt (see clock_alarm_set)
+ *  Comment out to save code and memory.
+ */
+
+//#define CLOCK_ALARM
+
+#define CLOCK_ALARMS	8	/* up to 8 */
+
 /*
  * Initialize the clock (set up timer 4)
  * in: Millisecond callback
@@ -41,39 +74,176 @@ char clock_set(char *);
 
 /*
  *  Get/set binary values for day, hour, minute, second
+ *  Readers get a consistent copy without holding off the clock interrupt.
+ *  The day is a free running count (0-255, wraps) of midnights passed.
+ *  Setting it does not change the seconds counter or calendar date.
  *  out: (4 bytes set)
  */
 
 void clock_bin_get(char *);
 void clock_bin_set(char *);
 
+/*
+ *  Get/set seconds counter (epoch seconds)
+ *
+ *  Seconds since 2000-01-01 00:00:00, good until 2136. Counts with the
+ *  clock and follows clock_set(), clock_bin_set() and clock_cal_set().
+ *  Setting it also sets the time of day, and the calendar if enabled.
+ *  The day count of clock_bin_get() is not changed.
+ *  Timestamps and time differences are plain unsigned long math.
+ *  Safe to read at any time outside interrupts.
+ */
+
+unsigned long clock_seconds(void);
+void clock_seconds_set(unsigned long);
+
 /*
  *  Set large and fine clock trim
  *  Positive values speed up, negative values slow down
+ *  For finer steps, see clock_trim_ppm() below.
  *  in: large +/- (0.4%), fine +/- (0.1%)
  */
 
 void clock_trim(signed char, signed char);
 
+/*
+ *  Set/get fractional clock trim, applied by adding or dropping single
+ *  ticks. Resolution is 1/16 ppm, range +/-1000 ppm. Used with or in
+ *  place of clock_trim().
+ *  in: trim in 1/16 ppm, positive speeds up
+ */
+
+void clock_trim_ppm(short);
+short clock_trim_get(void);
+
+#ifdef CLOCK_PPS
+/*
+ *  Discipline the clock from a 1PPS input (eg, GPS) on timer 2 capture
+ *
+ *  lib_cap2 captures both edges, so two captures make one period:
+ *
+ *    cap2_init(CAP2_16_MHZ);
+ *    ...
+ *    if (cap2_count() >= 2)
+ *        clock_pps(cap2_get() + cap2_get());
+ *
+ *  This measures the CPU clock, so use clock_trim(0, 0) and a crystal.
+ *  The trim converges in CLOCK_PPS_AVG seconds and tracks after that.
+ *  The time of day is not stepped to the PPS edge.
+ *
+ *  in:  PPS period in CPU clocks (low 16 bits)
+ *  out: zero = sample added, 1 = sample rejected, 2 = trim updated
+ */
+
+char clock_pps(unsigned short);
+#endif
+
 void timer4_isr(void) __interrupt (IRQ_TIM4);
 
+#ifdef CLOCK_ALARM
+/*
+ *  Set alarm (replaces any alarm with the same number)
+ *
+ *  Alarms fire at hh:mm:00. Hour or minute may be CLOCK_ANY, so
+ *  CLOCK_ANY, CLOCK_ANY is every minute and CLOCK_ANY, 30 is every hour
+ *  at half past. With CLOCK_AL_SEC the alarm fires every second and the
+ *  times are ignored. The weekday mask has bit 0 for Monday through bit
+ *  6 for Sunday (CLOCK_CALENDAR only), or zero for every day.
+ *
+ *  A fired alarm sets its bit for clock_alarm_pending() and calls the
+ *  callback with the alarm number, from the clock interrupt. Keep it
+ *  short, eg sched_post() with a task of the same number.
+ *  Times skipped by clock_set() do not fire alarms. Alarms due during
+ *  clock_halt() fire late, on wakeup.
+ *
+ *  in:  alarm number, hour, minute, weekday mask, flags, callback or NULL
+ *  out: zero = ok
+ */
+
+#define CLOCK_ANY	0xff	/* any hour or minute */
+#define CLOCK_AL_ONCE	0x01	/* clear alarm after it fires */
+#define CLOCK_AL_SEC	0x02	/* fire every second */
+
+#define CLOCK_DAYS_WEEK	0x1f	/* Monday to Friday */
+#define CLOCK_DAYS_END	0x60	/* Saturday and Sunday */
+
+char clock_alarm_set(char, char, char, char, char, void (*)(char));
+
+/*
+ *  Clear alarm
+ *  in: alarm number
+ */
+
+void clock_alarm_clear(char);
+
+/*
+ *  Get and clear alarms fired since the last call
+ *  out: bit mask of alarm numbers
+ */
+
+unsigned char clock_alarm_pending(void);
+#endif
+
+#ifdef CLOCK_HALT
+/*
+ *  Halt CPU (active halt) until auto wakeup, then advance the clock
+ *
+ *  The millisecond tick stops while halted. The halt is made of auto
+ *  wakeup slices of up to CLOCK_HALT_SLICE ms, and the clock is advanced
+ *  after each, but the millisecond and 1/10 second callbacks do not run
+ *  for that time. If another interrupt (eg, a port) ends the halt early,
+ *  the time spent in the broken slice is not known and is lost, so the
+ *  clock falls behind by at most one slice.
+ *  The wakeup interval is timed by the LSI (128 khz +/-12.5%, not
+ *  trimmed), so keep halts short where accuracy matters.
+ *
+ *  Wakeups per hour with nothing else to do (computed, not measured):
+ *  3600000 / CLOCK_HALT_SLICE, so 3516 at 1024 ms, or 118 with the
+ *  slice set to 30720 (one halt per call, and up to 30.72 s lost).
+ *  With timers, add one wakeup for each timer expiry.
+ *
+ *  With lib_timer and lib_sched, an idle hook can sleep to the next
+ *  timer and keep the timers in step:
+ *
+ *    ms = timer_next();
+ *    if (ms > 2)
+ *        timer_skip(clock_halt(ms - 1));
+ *
+ *  in:  maximum milliseconds to halt (up to 30720)
+ *  out: milliseconds the clock was advanced
+ */
+
+unsigned short clock_halt(unsigned short);
+
+void clock_awu_isr(void) __interrupt (IRQ_AWU);
+#endif
+
 /*
  *  OPTIONAL CALENDAR FUNCTIONS
  */
 #ifdef CLOCK_CALENDAR
 typedef struct {
-    int		year;		/* 2000-2199 */
+    int		year;		/* 2000-2135 */
     char	month;		/* 1-12 */
     char	date;		/* 1-31 */
-    char	day;		/* 1-7 */
+    char	day;		/* 1-7, Monday = 1 */
 } CLOCK_CAL;
 
 /*
  *  Get or set current year, month, date, day of week
+ *  Set keeps the time of day, and sets the day of week from the date.
  */
 void clock_cal_get(CLOCK_CAL *);
 void clock_cal_set(CLOCK_CAL *);
 
+/*
+ *  Convert between epoch seconds and calendar with time of day
+ *  Gregorian leap years (2100 is not), day of week is set from the date.
+ *  hms is hours, minutes, seconds (3 bytes) or NULL.
+ */
+void clock_epoch_cal(unsigned long, CLOCK_CAL *, char *);
+unsigned long clock_cal_epoch(CLOCK_CAL *, char *);
+
 /*
  *  Advance the calendar date (for testing calendar function)
  */
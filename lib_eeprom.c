@@ -1,13 +1,13 @@
 /*
  *  File name:  lib_eeprom.c
  *  Date first: code clipped from lib_log
- *  Date last:  08/21/2018
+ *  Date last:  10/19/2026
  *
  *  Description: Library for EEPROM functions
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2018 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2018, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
@@ -50,3 +50,37 @@ __asm
 __endasm;
 }
 
+/******************************************************************************
+ *
+ *  Write bytes to EEPROM
+ *  Each byte waits for EOP, up to 65536 polls (well over the 6 ms write).
+ *  in:  source, EEPROM destination, byte count
+ *  out: zero = fail (could not unlock, write protected, or timed out)
+ */
+
+char eeprom_write(char *src, char *dst, short count)
+{
+    unsigned short wait;
+    char	sr;
+
+    if (!eeprom_unlock())
+	return 0;
+
+    while (count--) {
+	if (*dst != *src) {
+	    *dst = *src;
+	    wait = 0;
+	    do {
+		sr = FLASH_IAPSR;	/* read clears EOP and WR_PG_DIS */
+		if ((sr & 0x01) || !--wait) {
+		    eeprom_lock();
+		    return 0;
+		}
+	    } while (!(sr & 0x04));
+	}
+	src++;
+	dst++;
+    }
+    eeprom_lock();
+    return 1;
+}
@@ -1,13 +1,13 @@
 /*
  *  File name:  lib_eeprom.h
  *  Date first: code clipped from lib_log
- *  Date last:  08/21/2018
+ *  Date last:  10/19/2026
  *
  *  Description: Library for EEPROM functions
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2018 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2018, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
@@ -25,6 +25,17 @@ char eeprom_unlock(void);
 void eeprom_lock(void);
 
 /*
- *  Write word to EEPROM
- *  in: source, dest
+ *  Write 4 byte word to EEPROM or Flash: eeprom_word(source, dest)
+ *  is declared in lib_log.h and built with lib_log.
  */
+
+/*
+ *  Write bytes to EEPROM, unlocking and locking around the write
+ *  Bytes that already match are skipped. A write to a protected page
+ *  (WR_PG_DIS) or one that never ends stops the write, and the EEPROM
+ *  is locked again.
+ *  in:  source, EEPROM destination, byte count
+ *  out: zero = fail (could not unlock, write protected, or timed out)
+ */
+
+char eeprom_write(char *, char *, short);
@@ -1,13 +1,13 @@
 /*
  *  File name:  lib_flash.c
  *  Date first: code clipped from lib_log
- *  Date last:  10/18/2018
+ *  Date last:  10/19/2026
  *
  *  Description: Library for Flash memory functions
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2018 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2018, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
@@ -23,6 +23,10 @@
 static char p_flash_erase(char *);
 static char r_flash_erase[30];
 #endif
+#ifdef FLASH_BLOCK_PROG
+static char p_flash_block(char *);
+static char r_flash_block[36];
+#endif
 
 #pragma disable_warning 59
 
@@ -37,6 +41,9 @@ void flash_init(void)
 #ifdef FLASH_BLOCK_ERASE
     memcpy(r_flash_erase, p_flash_erase, 30);
 #endif
+#ifdef FLASH_BLOCK_PROG
+    memcpy(r_flash_block, p_flash_block, 36);
+#endif
 }
 
 #ifdef FLASH_BLOCK_ERASE
@@ -82,6 +89,61 @@ __endasm;
 }
 #endif	/* FLASH_BLOCK_ERASE */
 
+#ifdef FLASH_BLOCK_PROG
+/******************************************************************************
+ *
+ *  Program FLASH or EEPROM block (64 or 128 bytes)
+ *  (Standard block program from RAM, about 6 ms with interrupts off)
+ *
+ *  in:  block address, source buffer
+ * out: zero = success
+ */
+
+char flash_block(char *dst, char *src)
+{
+    dst, src;
+__asm
+#if __SDCCCALL == 0
+    ldw		x, (3, sp)
+    ldw		y, (5, sp)
+#else
+    ldw		y, (3, sp)
+#endif
+    clr		a
+    push	cc
+    sim
+    call	_r_flash_block
+    pop		cc
+__endasm;
+}
+
+static char p_flash_block(char *ptr)
+{
+    ptr;
+__asm
+    bset	_FLASH_CR2, #0
+    bres	_FLASH_NCR2, #0
+    push	#FLASH_BLOCK
+00001$:
+    ld		a, (y)
+    ld		(x), a
+    incw	x
+    incw	y
+    dec		(1, sp)
+    jrne	00001$
+    pop		a
+    clrw	x		; 65536 polls, 13 ms at 24 mhz
+00002$:
+    decw	x
+    jreq	00090$
+    btjf	_FLASH_IAPSR, #2, 00002$
+    ret
+00090$:
+    inc		a
+__endasm;
+}
+#endif	/* FLASH_BLOCK_PROG */
+
 /******************************************************************************
  *
  * Unlock FLASH for writing
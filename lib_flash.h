@@ -1,13 +1,13 @@
 /*
  *  File name:  lib_flash.h
  *  Date first: code clipped from lib_log
- *  Date last:  10/18/2018
+ *  Date last:  10/19/2026
  *
  *  Description: Library for Flash memory functions
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2018 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2018, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
@@ -45,3 +45,19 @@ char flash_erase(char *);
  * out: zero = success
  */
 char flash_clear(char *, int);
+
+#define FLASH_BLOCK_PROG /* comment out to save setup and 36 bytes of RAM */
+
+/*
+ *  Program FLASH or EEPROM block (64 or 128 bytes) from RAM buffer
+ *  Standard block programming erases and then writes the whole block,
+ *  which takes tPROG (6 ms, 6.6 ms max) instead of 6 ms per word.
+ *  Interrupts are off for that time. The wait for the end of programming
+ *  gives up after 65536 polls (13 ms at 24 mhz, longer at lower clocks).
+ *  Memory must be unlocked first.
+ *
+ *  in:  block address, source buffer (in RAM)
+ *  out: zero = success
+ */
+
+char flash_block(char *, char *);
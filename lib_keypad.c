@@ -1,13 +1,13 @@
 /*
  *  File name:  lib_keypad.c
  *  Date first: 10/11/2018
- *  Date last:  10/14/2018
+ *  Date last:  10/19/2026
  *
  *  Description: STM8 Library for simple keypad
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2018 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2018, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
@@ -17,6 +17,7 @@
 #include "stm8s_header.h"
 
 #include "lib_keypad.h"
+#include "lib_prof.h"
 
 static char *kmap, *kcur;
 
@@ -74,7 +75,9 @@ void keypad_poll(void)
 	return;
     poll_count = KP_POLL_MS;
 
+    PROF_ENTER(PROF_KEYPAD);
     key = check_key();
+    PROF_EXIT(PROF_KEYPAD);
     if (!key) {
 	if (!bounce)
 	    return;
@@ -1,13 +1,13 @@
 /*
  *  File name:  lib_keypad.h
  *  Date first: 10/11/2018
- *  Date last:  10/14/2018
+ *  Date last:  10/19/2026
  *
  *  Description: STM8 Library for simple keypad
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2018 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2018, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
@@ -38,7 +38,7 @@ void keypad_init(KP_PIN *, KP_PIN *);
 /*
  *  Poll for keypad status
  *  Call every millisecond
- *  (profiling with Timer4 gives 36 uSec per poll)
+ *  (profiling with Timer4 gives 36 uSec per poll, see lib_prof.h)
  */
 void keypad_poll(void);
 
@@ -1,13 +1,13 @@
 /*
  *  File name:  lib_log.c
  *  Date first: 03/26/2018
- *  Date last:  10/16/2018
+ *  Date last:  10/19/2026
  *
  *  Description: Library for using a many entry system log
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2018 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2018, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
@@ -16,9 +16,12 @@
  * save the current clock as timestamps.
  */
 
+#include <string.h>
+
 #include "stm8s_header.h"
 
 #include "lib_log.h"
+#include "lib_board.h"
 #include "lib_clock.h"
 #include "lib_eeprom.h"
 #include "lib_flash.h"
@@ -36,16 +39,60 @@ static long log_stamp;
 static void (*mem_lock)(void);
 static char (*mem_unlock)(void);
 
+#ifdef LOG_RECORDS
+static char *rec_base;
+static char *rec_end;
+static char *rec_old;		/* oldest block */
+static char *rec_blk;		/* newest block */
+static char *rec_put;		/* next record in newest block */
+static unsigned long rec_stamp;	/* stamp of newest record */
+
+static void (*rec_lock)(void);
+static char (*rec_unlock)(void);
+
+static LOG_REC *rec_next(LOG_REC *, char *, unsigned long *);
+static char rec_block(char *);
+#endif
+
+#ifdef LOG_ASYNC
+#ifdef LOG_BATCH
+#error "LOG_ASYNC and LOG_BATCH can not be used together"
+#endif
+static LOG_ENTRY log_queue[LOG_QUEUE];
+static volatile char log_q_get;
+static volatile char log_q_put;
+static volatile char log_busy;		/* programming in background */
+static char log_half;			/* second word of entry next */
+static short log_lost;			/* entries lost, queue full */
+
+static void log_step(void);
+static char log_hv_wait(void);
+#endif
+
+#ifdef LOG_BATCH
+static char log_buf[FLASH_BLOCK];	/* staged copy of block */
+static char *log_blk;			/* block in log_buf, or NULL */
+static char log_dirty;			/* log_buf has new entries */
+#endif
+
 /******************************************************************************
  *
  * Initialize the system log
  * in: base address, number of enties
+ *
+ * Entries are written in stamp order around the ring, so the stamps from
+ * the first entry up to the newest are all at least the first stamp, and
+ * those after are less (older, or zero if not written yet). The newest
+ * is found by binary search for the last entry at least the first stamp.
+ * If equal stamps (several entries in one second) span the wrap, that
+ * does not hold, and the entries are scanned for the drop instead.
  */
 
 void log_init(char *base, short count)
 {
-    LOG_ENTRY	*old, *new, *ptr;
-    short	i;
+    LOG_ENTRY	*new, *old;
+    unsigned long first;
+    short	lo, hi, mid;
 
     log_base  = (LOG_ENTRY *)base;
     log_end   = log_base + count;
@@ -53,24 +100,55 @@ void log_init(char *base, short count)
     log_size  = sizeof(LOG_ENTRY);
     log_stamp = 0;
 
-    old = log_base;
+    lo = 0;
+    if (!log_base->stamp)
+	lo = 1;			/* not written since erase */
     new = log_base;
-    ptr = log_base;
-
-    for (i = 0; i < count; i++) {
-	ptr++;
-	if (!ptr->stamp)
-	    continue;
-	if (old->stamp > ptr->stamp)
-	    old = ptr;
-	if (log_stamp < ptr->stamp) {
-	    log_stamp = ptr->stamp;
-	    new = ptr;
+    old = log_base;
+    if (lo < count && log_base[lo].stamp) {
+	first = log_base[lo].stamp;
+	hi = count - 1;
+	if (hi > lo && log_base[hi].stamp == first) {
+	    new = log_base + lo;
+	    while (new + 1 != log_end &&
+		   new[1].stamp >= new->stamp)
+		new++;
+	}
+	else {
+	    while (lo < hi) {
+		mid = (lo + hi + 1) >> 1;
+		if (log_base[mid].stamp >= first)
+		    lo = mid;
+		else
+		    hi = mid - 1;
+	    }
+	    new = log_base + lo;
+	}
+	log_stamp = new->stamp;
+
+	old = new + 1;		/* oldest follows newest, if written */
+	if (old == log_end)
+	    old = log_base;
+	if (!old->stamp) {
+	    old = log_base;
+	    if (!old->stamp)
+		old++;
 	}
     }
     log_stamp++;
     log_old = old;
     log_new = new;
+#ifdef LOG_BATCH
+    log_blk = 0;
+    log_dirty = 0;
+#endif
+#ifdef LOG_ASYNC
+    log_q_get = 0;
+    log_q_put = 0;
+    log_busy  = 0;
+    log_half  = 0;
+    log_lost  = 0;
+#endif
 
     if (((short)base > 0x8000)) {
 	mem_lock   = flash_lock;
@@ -99,17 +177,31 @@ void log_erase(void)
     ptr = (char *)log_base;
     i = log_count;
 
-    if (!mem_unlock())
-	return;
-    while (i) {
-	eeprom_word(zero, ptr);
-	ptr += 4;
-	eeprom_word(zero, ptr);
-	ptr += 4;
-	i--;
+#ifdef LOG_ASYNC
+    log_flush();
+#endif
+#ifdef LOG_BATCH
+    log_blk = 0;
+    log_dirty = 0;
+#endif
+#ifdef FLASH_BLOCK_ERASE
+    if (mem_unlock == flash_unlock)
+	flash_clear(ptr, i * sizeof(LOG_ENTRY));
+    else
+#endif
+    {
+	if (!mem_unlock())
+	    return;
+	while (i) {
+	    eeprom_word(zero, ptr);
+	    ptr += 4;
+	    eeprom_word(zero, ptr);
+	    ptr += 4;
+	    i--;
+	}
+	mem_lock();
     }
-    mem_lock();
-    log_stamp = 0;
+    log_stamp = 1;		/* zero is an empty entry */
     log_old = log_base;
     log_new = log_base;
 }
@@ -124,6 +216,13 @@ char log_write(char type)
 {
     LOG_ENTRY	entry;
     char	binary[4], *src, *dst;
+#ifdef LOG_BATCH
+    char	*blk;
+#endif
+#ifdef LOG_ASYNC
+    char	put;
+    char	cc;
+#endif
 
     clock_bin_get(binary);
     entry.stamp = log_stamp;
@@ -132,8 +231,34 @@ char log_write(char type)
     entry.clock_m = binary[2];
     entry.clock_s = binary[3];
 
+#ifdef LOG_ASYNC
+    cc = irq_save();
+    put = (log_q_put + 1) & (LOG_QUEUE - 1);
+    if (put == log_q_get) {
+	log_lost++;
+	irq_restore(cc);
+	return 1;
+    }
+    memcpy(&log_queue[log_q_put], &entry, sizeof(LOG_ENTRY));
+    log_q_put = put;
+    if (!log_busy) {
+	if (!mem_unlock()) {
+	    irq_restore(cc);
+	    return 1;
+	}
+	log_busy = 1;
+#ifdef LOG_ASYNC_IRQ
+	FLASH_CR1 |= 0x02;	/* interrupt on end of program */
+#endif
+	log_step();
+    }
+    irq_restore(cc);
+    return 0;
+#else	/* not LOG_ASYNC */
+#ifndef LOG_BATCH
     if (!mem_unlock())
 	return 1;
+#endif
 
     log_new++;
     if (log_new == log_end)
@@ -146,13 +271,212 @@ char log_write(char type)
     dst = (char *)log_new;
     src = (char *)&entry;
 
+#ifdef LOG_BATCH
+    blk = (char *)((unsigned short)dst & ~(FLASH_BLOCK - 1));
+    if (blk != log_blk) {
+	if (log_commit())
+	    return 1;
+	memcpy(log_buf, blk, FLASH_BLOCK);
+	log_blk = blk;
+    }
+    dst = log_buf + (dst - blk);
+    memcpy(dst, src, sizeof(LOG_ENTRY));
+    log_dirty = 1;
+
+    if (dst + sizeof(LOG_ENTRY) == log_buf + FLASH_BLOCK ||
+	log_new + 1 == log_end)
+	return log_commit();
+#else
     eeprom_word(src, dst);
     eeprom_word(src + 4, dst + 4);
     mem_lock();
+#endif
 
     return 0;
+#endif	/* LOG_ASYNC */
+}
+
+#ifdef LOG_ASYNC
+/******************************************************************************
+ *
+ *  Continue background programming, when the last word is done
+ *  Call often (eg, from a scheduler tick), or use LOG_ASYNC_IRQ.
+ *
+ *  EOP is cleared by any read of FLASH_IAPSR (eeprom_unlock(), the flash
+ *  functions), so HVOFF is taken as well. It is set while the high voltage
+ *  is off, and log_step() waits for it to go low after starting a word.
+ */
+
+void log_poll(void)
+{
+    char	cc;
+
+    cc = irq_save();
+    if (log_busy && (FLASH_IAPSR & 0x44))	/* EOP or HVOFF */
+	log_step();
+    irq_restore(cc);
 }
 
+/******************************************************************************
+ *
+ *  Wait for all queued entries to be programmed
+ *  Gives up if 65536 polls go by without a word finishing, and drops the
+ *  rest of the queue (counted as lost).
+ *  out: zero = success
+ */
+
+char log_flush(void)
+{
+    unsigned short wait;
+    char	half;
+    char	cc;
+
+    wait = 0;
+    half = log_half;
+    while (log_busy) {
+	log_poll();
+	if (half != log_half) {
+	    half = log_half;
+	    wait = 0;
+	}
+	else if (!--wait)
+	    break;
+    }
+    if (!log_busy)
+	return 0;
+
+    cc = irq_save();
+#ifdef LOG_ASYNC_IRQ
+    FLASH_CR1 &= ~0x02;
+#endif
+    mem_lock();
+    log_lost += (log_q_put - log_q_get) & (LOG_QUEUE - 1);
+    log_q_get = log_q_put;
+    log_half = 0;
+    log_busy = 0;
+    irq_restore(cc);
+    return 1;
+}
+
+/******************************************************************************
+ *
+ *  Get count of entries lost to a full queue
+ *  in: non-zero to clear the count
+ */
+
+short log_overflow(char clear)
+{
+    short	lost;
+    char	cc;
+
+    cc = irq_save();
+    lost = log_lost;
+    if (clear)
+	log_lost = 0;
+    irq_restore(cc);
+    return lost;
+}
+
+#ifdef LOG_ASYNC_IRQ
+/******************************************************************************
+ *
+ *  Flash end of program interrupt
+ */
+
+void log_flash_isr(void) __interrupt (IRQ_FLASH)
+{
+    if (log_busy && (FLASH_IAPSR & 0x44))
+	log_step();
+}
+#endif
+
+/******************************************************************************
+ *
+ *  Start next word write, or finish (interrupts off)
+ *  Each entry is two words. The CPU only continues during the write for
+ *  data EEPROM (read while write). A Flash log stalls for each word, so
+ *  the word is already done on return and the next one is started here.
+ */
+
+static void log_step(void)
+{
+    LOG_ENTRY	*entry;
+
+    do {
+	entry = &log_queue[log_q_get];
+	if (log_half) {
+	    eeprom_word((char *)entry + 4, (char *)log_new + 4);
+	    log_half = 0;
+	    log_q_get = (log_q_get + 1) & (LOG_QUEUE - 1);
+	    continue;
+	}
+	if (log_q_get == log_q_put) {
+#ifdef LOG_ASYNC_IRQ
+	    FLASH_CR1 &= ~0x02;
+#endif
+	    mem_lock();
+	    log_busy = 0;
+	    return;
+	}
+	log_new++;
+	if (log_new == log_end)
+	    log_new =  log_base;
+	if (log_new == log_old) {
+	    log_old++;
+	    if (log_old == log_end)
+		log_old =  log_base;
+	}
+	eeprom_word((char *)entry, (char *)log_new);
+	log_half = 1;
+    } while (!log_hv_wait());
+}
+
+/******************************************************************************
+ *
+ *  Wait for the high voltage to come on for the word just started, so
+ *  HVOFF can't be taken as the end of it
+ *  out: zero = word already done
+ */
+
+static char log_hv_wait(void)
+{
+    char	sr;
+    char	i;
+
+    i = 0;
+    do {
+	sr = FLASH_IAPSR;
+	if (sr & 0x04)		/* EOP */
+	    return 0;
+	if (!(sr & 0x40))	/* HVOFF low, programming */
+	    return 1;
+    } while (--i);
+    return 1;
+}
+#endif	/* LOG_ASYNC */
+
+#ifdef LOG_BATCH
+/******************************************************************************
+ *
+ *  Program staged log entries
+ *  out: zero = success
+ */
+
+char log_commit(void)
+{
+    char	retval;
+
+    if (!log_dirty)
+	return 0;
+    if (!mem_unlock())
+	return 1;
+    retval = flash_block(log_blk, log_buf);
+    mem_lock();
+    log_dirty = 0;
+    return retval;
+}
+#endif
+
 /******************************************************************************
  *
  *  Advance log timestamp
@@ -174,6 +498,17 @@ __asm
 __endasm;
 }
 
+/******************************************************************************
+ *
+ *  Set log timestamp, if not lower
+ */
+
+void log_stamp_set(unsigned long stamp)
+{
+    if (stamp > log_stamp)
+	log_stamp = stamp;
+}
+
 /******************************************************************************
  *
  *  Scan all log entries
@@ -184,6 +519,9 @@ void log_scan(void (*callback)(LOG_ENTRY *))
 {
     LOG_ENTRY *entry;
 
+#ifdef LOG_BATCH
+    log_commit();
+#endif
     entry = log_old;
     while (1) {
 	if (entry->stamp)
@@ -206,6 +544,9 @@ short log_valid(void)
     LOG_ENTRY	*entry;
     short	count;
 
+#ifdef LOG_BATCH
+    log_commit();
+#endif
     entry = log_base;
     count = 0;
 
@@ -217,6 +558,249 @@ short log_valid(void)
     return count;
 }
 
+#ifdef LOG_RECORDS
+/******************************************************************************
+ *
+ *  Initialize record log
+ *  in: base address (block aligned), number of blocks
+ *
+ *  Blocks are used in order around the ring, and each block starts with
+ *  a stamp above all before it. So the blocks up to the newest start with
+ *  a stamp at least the first block's, and the blocks after start lower
+ *  (or are empty). If power was lost just after the ring erased block 0,
+ *  block 0 is empty and the search starts at block 1.
+ */
+
+void log_rec_init(char *base, short blocks)
+{
+    LOG_REC	*rec, *next;
+    unsigned long first, stamp;
+    short	lo, hi, mid;
+    char	*blk;
+
+    rec_base = base;
+    rec_end  = base + blocks * FLASH_BLOCK;
+
+    if (((short)base > 0x8000)) {
+	rec_lock   = flash_lock;
+	rec_unlock = flash_unlock;
+    }
+    else {
+	rec_lock   = eeprom_lock;
+	rec_unlock = eeprom_unlock;
+    }
+
+    rec_old = base;
+    rec_blk = base;
+    rec_put = base;
+    rec_stamp = 0;
+    lo = 0;
+    first = ((LOG_REC *)base)->stamp;
+    if (!first) {
+	lo = 1;			/* block 0 erased, not written yet */
+	first = ((LOG_REC *)(base + FLASH_BLOCK))->stamp;
+	if (!first)
+	    return;		/* empty */
+    }
+
+    hi = blocks - 1;
+    while (lo < hi) {
+	mid = (lo + hi + 1) >> 1;
+	if (((LOG_REC *)(base + mid * FLASH_BLOCK))->stamp >= first)
+	    lo = mid;
+	else
+	    hi = mid - 1;
+    }
+    rec_blk = base + lo * FLASH_BLOCK;
+
+    blk = rec_blk;		/* oldest follows newest, or an erased block */
+    for (mid = 0; mid < 2; mid++) {
+	blk += FLASH_BLOCK;
+	if (blk == rec_end)
+	    blk = base;
+	if (((LOG_REC *)blk)->stamp) {
+	    rec_old = blk;
+	    break;
+	}
+    }
+
+    rec = (LOG_REC *)rec_blk;	/* skip to end of newest block */
+    stamp = 0;
+    while ((next = rec_next(rec, rec_blk, &stamp)))
+	rec = next;
+    rec_put = (char *)rec;
+    rec_stamp = stamp;
+    log_stamp_set(stamp + 1);
+}
+
+/******************************************************************************
+ *
+ *  Erase all records
+ */
+
+void log_rec_erase(void)
+{
+    char	*ptr;
+
+    if (!rec_unlock())
+	return;
+    for (ptr = rec_base; ptr != rec_end; ptr += FLASH_BLOCK)
+	rec_block(ptr);
+    rec_lock();
+    rec_old = rec_base;
+    rec_blk = rec_base;
+    rec_put = rec_base;
+    rec_stamp = 0;
+}
+
+/******************************************************************************
+ *
+ *  Write record
+ *  in:  record type, payload, payload length
+ *  out: zero = success
+ */
+
+char log_rec_write(char type, char *data, char len)
+{
+    char	rec[sizeof(LOG_REC) + LOG_REC_MAX + 3];
+    char	*dst;
+    char	size;
+    char	i;
+
+    if (len > LOG_REC_MAX)
+	return 1;
+    size = (sizeof(LOG_REC) + len + 3) & ~3;
+
+    if (!rec_unlock())
+	return 1;
+    if (rec_put + size > rec_blk + FLASH_BLOCK) {
+	rec_blk += FLASH_BLOCK;		/* next block */
+	if (rec_blk == rec_end)
+	    rec_blk = rec_base;
+	if (rec_blk == rec_old) {
+	    rec_old += FLASH_BLOCK;
+	    if (rec_old == rec_end)
+		rec_old = rec_base;
+	}
+	rec_put = rec_blk;
+	if (rec_block(rec_blk)) {
+	    rec_lock();
+	    return 1;
+	}
+	if (log_stamp <= rec_stamp)	/* block order needs a higher stamp */
+	    log_stamp = rec_stamp + 1;
+    }
+    if (log_stamp < rec_stamp)		/* eg, after log_erase() */
+	log_stamp = rec_stamp;
+    rec_stamp = log_stamp;
+
+    ((LOG_REC *)rec)->stamp = log_stamp;
+    ((LOG_REC *)rec)->type  = type;
+    ((LOG_REC *)rec)->len   = len;
+    for (i = 0; i < len; i++)
+	rec[sizeof(LOG_REC) + i] = data[i];
+    for (i += sizeof(LOG_REC); i < size; i++)
+	rec[i] = 0;
+
+    dst = rec_put;
+    rec_put += size;
+    for (i = 0; i < size; i += 4)
+	eeprom_word(rec + i, dst + i);
+    rec_lock();
+    return 0;
+}
+
+/******************************************************************************
+ *
+ *  Write record with one 16 bit value
+ *  in:  record type, value
+ *  out: zero = success
+ */
+
+char log_rec_short(char type, short val)
+{
+    return log_rec_write(type, (char *)&val, 2);
+}
+
+/******************************************************************************
+ *
+ *  Scan all records, oldest first
+ *  in: callback function for each record
+ */
+
+void log_rec_scan(void (*callback)(LOG_REC *))
+{
+    LOG_REC	*rec, *next;
+    char	*blk;
+    unsigned long stamp;
+
+    blk = rec_old;
+    stamp = 0;
+    while (1) {
+	rec = (LOG_REC *)blk;
+	while ((next = rec_next(rec, blk, &stamp))) {
+	    callback(rec);
+	    rec = next;
+	}
+	if (blk == rec_blk)
+	    break;
+	blk += FLASH_BLOCK;
+	if (blk == rec_end)
+	    blk = rec_base;
+    }
+}
+
+/******************************************************************************
+ *
+ *  Step to next record in block
+ *
+ *  A record is valid if it has a stamp not lower than the last, and a
+ *  payload that fits. The rest of the block is erased (stamp zero).
+ *
+ *  in:  record (valid or not), its block, last stamp (updated)
+ *  out: next record, or NULL if this one is not valid or the last
+ */
+
+static LOG_REC *rec_next(LOG_REC *rec, char *blk, unsigned long *stamp)
+{
+    char	*next;
+
+    if ((char *)rec + sizeof(LOG_REC) > blk + FLASH_BLOCK ||
+	!rec->stamp || rec->stamp < *stamp ||
+	rec->len > LOG_REC_MAX)
+	return 0;
+    next = (char *)rec + ((sizeof(LOG_REC) + rec->len + 3) & ~3);
+    if (next > blk + FLASH_BLOCK)
+	return 0;
+    *stamp = rec->stamp;
+    return (LOG_REC *)next;
+}
+
+/******************************************************************************
+ *
+ *  Erase one block (memory unlocked)
+ *  out: zero = success
+ */
+
+static char rec_block(char *blk)
+{
+    char	zero[4];
+    char	i;
+
+#ifdef FLASH_BLOCK_ERASE
+    if (rec_unlock == flash_unlock)
+	return flash_erase(blk);
+#endif
+    zero[0] = 0;
+    zero[1] = 0;
+    zero[2] = 0;
+    zero[3] = 0;
+    for (i = 0; i < FLASH_BLOCK; i += 4)
+	eeprom_word(zero, blk + i);
+    return 0;
+}
+#endif	/* LOG_RECORDS */
+
 /******************************************************************************
  *
  *  Do EEPROM word write
@@ -1,17 +1,40 @@
 /*
  *  File name:  lib_log.h
  *  Date first: 03/26/2018
- *  Date last:  08/21/2018
+ *  Date last:  10/19/2026
  *
  *  Description: Library for maintaining a many entry system log
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2018 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2018, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
  *
+ *  Option to stage entries in RAM and program a whole block at a time
+ *  with flash_block() (needs FLASH_BLOCK_PROG and flash_init()). This is
+ *  one program cycle per block instead of two per entry. The log base
+ *  must be block aligned. Staged entries are lost on reset, unless
+ *  log_commit() is called first.
+ */
+
+//#define LOG_BATCH
+
+/*
+ *  Option to queue entries in RAM and return at once, programming them
+ *  in the background (not with LOG_BATCH). The queue is driven by the
+ *  Flash end of program interrupt with LOG_ASYNC_IRQ, else by log_poll().
+ *  Best with a data EEPROM log: with a Flash log the CPU still stalls
+ *  while each word programs.
+ */
+
+//#define LOG_ASYNC
+//#define LOG_ASYNC_IRQ
+
+#define LOG_QUEUE	8	/* queue size, power of 2 (one unused) */
+
+/*
  *  Log entry
  */
 
@@ -23,6 +46,30 @@ typedef struct {
     char	clock_s;	/* clock second */
 } LOG_ENTRY;
 
+/*
+ *  Option for variable length records with payload (see log_rec_init)
+ *  Comment out to save code and memory.
+ */
+
+//#define LOG_RECORDS
+
+#ifdef LOG_RECORDS
+/*
+ *  Record header, followed by len bytes of payload and padding to a
+ *  multiple of 4 bytes. The stamp is the log timestamp, which can be
+ *  set to epoch seconds with log_stamp_set(), so no clock fields.
+ */
+
+typedef struct {
+    unsigned long stamp;	/* non-zero timestamp */
+    char	type;		/* record type */
+    char	len;		/* payload length */
+} LOG_REC;
+
+#define LOG_REC_MAX	26	/* payload bytes, record up to 32 bytes */
+#define LOG_REC_DATA(r)	((char *)(r) + sizeof(LOG_REC))
+#endif
+
 /*
  *  Initialize the log library
  *  in: base address, number of entries
@@ -35,6 +82,12 @@ void log_init(char *, short);
  */
 void log_second(void);
 
+/*
+ *  Set log timestamp, eg to clock_seconds() once the clock is set
+ *  Stamps must not go back, so lower values are ignored.
+ */
+void log_stamp_set(unsigned long);
+
 /*
  *  Erase all log entries
  */
@@ -42,11 +95,50 @@ void log_erase(void);
 
 /*
  *  Write new log entry
+ *  With LOG_ASYNC, the entry is queued and written later.
  *  in: event type
- * out: zero = success
+ * out: zero = success (non-zero = queue full with LOG_ASYNC)
  */
 char log_write(char);
 
+#ifdef LOG_ASYNC
+/*
+ *  Continue background programming (eg, from a scheduler tick)
+ *  Not needed with LOG_ASYNC_IRQ, unless other code reads FLASH_IAPSR
+ *  while the queue runs (which clears EOP and loses the interrupt).
+ */
+void log_poll(void);
+
+/*
+ *  Wait until all queued entries are programmed (eg, before shutdown)
+ *  Gives up if 65536 polls pass with no word finished, and drops the
+ *  rest of the queue (added to log_overflow()).
+ * out: zero = success
+ */
+char log_flush(void);
+
+/*
+ *  Get count of entries lost because the queue was full
+ *  in: non-zero to clear the count
+ */
+short log_overflow(char);
+
+#ifdef LOG_ASYNC_IRQ
+#include "vectors.h"
+
+void log_flash_isr(void) __interrupt (IRQ_FLASH);
+#endif
+#endif
+
+#ifdef LOG_BATCH
+/*
+ *  Program staged entries now (eg, before sleep or reset)
+ *  Also done when a block fills, and by log_scan() and log_valid().
+ *  out: zero = success
+ */
+char log_commit(void);
+#endif
+
 /*
  *  Scan all log entries
  *  in: callback function for each entry
@@ -59,6 +151,47 @@ void log_scan(void (*callback)(LOG_ENTRY *));
  */
 short log_valid(void);
 
+#ifdef LOG_RECORDS
+/*
+ *  Initialize record log
+ *
+ *  Records are packed back to back in blocks (FLASH_BLOCK bytes), and
+ *  never cross a block. A block is erased when the ring moves into it,
+ *  so the newest block is found by binary search on the first stamp
+ *  of each block, and records are read by skipping from header to
+ *  header. Records are written directly (not LOG_BATCH or LOG_ASYNC).
+ *  Call after log_init(), and log_rec_erase() before first use.
+ *
+ *  in: base address (block aligned), number of blocks (2 or more)
+ */
+void log_rec_init(char *, short);
+
+/*
+ *  Erase all records
+ */
+void log_rec_erase(void);
+
+/*
+ *  Write record
+ *  in:  record type, payload, payload length (up to LOG_REC_MAX)
+ *  out: zero = success
+ */
+char log_rec_write(char, char *, char);
+
+/*
+ *  Write record with one 16 bit value, eg max6675_read() or adc_val()
+ *  in:  record type, value
+ *  out: zero = success
+ */
+char log_rec_short(char, short);
+
+/*
+ *  Scan all records, oldest first
+ *  in: callback function for each record
+ */
+void log_rec_scan(void (*callback)(LOG_REC *));
+#endif
+
 /*
  *  Write word to EEPROM
  *  in: source, dest
@@ -0,0 +1,283 @@
+/*
+ *  File name:  lib_prof.c
+ *  Date first: 10/19/2026
+ *  Date last:  10/19/2026
+ *
+ *  Description: STM8 Library for profiling interrupts and functions
+ *
+ *  Author:     Richard Hodges
+ *
+ *  Copyright (C) 2026 Richard Hodges. All rights reserved.
+ *  Permission is hereby granted for any use.
+ *
+ ******************************************************************************
+ *
+ *  Timer 1 counts CPU clocks, and its update interrupt extends the count
+ *  to 32 bits for the load measurement.
+ */
+
+#include "stm8s_header.h"
+
+#include "lib_bindec.h"
+#include "lib_board.h"
+#include "lib_prof.h"
+
+#ifdef LIB_PROFILE
+static PROF_STAT prof_tab[PROF_POINTS];
+static unsigned short prof_start[PROF_POINTS];
+static unsigned short prof_zero;	/* cost of enter + exit */
+
+static volatile unsigned short prof_ovfl;	/* timer 1 wraps */
+static unsigned short prof_last;	/* last prof_idle() */
+static unsigned long prof_rest;		/* idle clocks */
+static unsigned long prof_mark;		/* start of load measurement */
+
+static unsigned short prof_count(void);
+static unsigned long prof_time(void);
+static void prof_clear(char);
+static void prof_num(void (*)(char), unsigned short);
+
+/******************************************************************************
+ *
+ *  Initialize profiler
+ */
+
+void prof_init(void)
+{
+    char	id;
+
+    TIM1_CR1   = 0;
+    TIM1_PSCRH = 0;		/* CPU clock */
+    TIM1_PSCRL = 0;
+    TIM1_ARRH  = 0xff;		/* free running */
+    TIM1_ARRL  = 0xff;
+    TIM1_EGR   = 1;		/* load prescaler */
+    TIM1_SR1   = 0;
+    TIM1_IER   = 1;		/* update interrupt */
+    TIM1_CR1   = 1;		/* enable counter */
+
+    prof_zero = 0;
+    prof_clear(0);
+    prof_enter(0);
+    prof_exit(0);
+    prof_zero = prof_tab[0].min;
+
+    for (id = 0; id < PROF_POINTS; id++)
+	prof_clear(id);
+    prof_ovfl = 0;
+    prof_rest = 0;
+    prof_last = prof_count();
+    prof_mark = prof_time();
+}
+
+/******************************************************************************
+ *
+ *  Profile point entry
+ *  in: point number
+ */
+
+void prof_enter(char id)
+{
+    prof_start[id] = prof_count();
+}
+
+/******************************************************************************
+ *
+ *  Profile point exit
+ *  in: point number
+ */
+
+void prof_exit(char id)
+{
+    PROF_STAT	*stat;
+    unsigned short time;
+
+    time = prof_count() - prof_start[id];
+    if (time > prof_zero)
+	time -= prof_zero;
+    else
+	time = 0;
+
+    stat = &prof_tab[id];
+    if (time < stat->min)
+	stat->min = time;
+    if (time > stat->max)
+	stat->max = time;
+    if (stat->count == 0xffff)
+	return;
+    stat->count++;
+    stat->sum += time;
+}
+
+/******************************************************************************
+ *
+ *  Get profile point statistics
+ *  in: point number, stats out, non-zero to clear after reading
+ */
+
+void prof_stat(char id, PROF_STAT *stat, char clear)
+{
+    char	cc;
+
+    cc = irq_save();
+    stat->min   = prof_tab[id].min;
+    stat->max   = prof_tab[id].max;
+    stat->sum   = prof_tab[id].sum;
+    stat->count = prof_tab[id].count;
+    if (clear)
+	prof_clear(id);
+    irq_restore(cc);
+}
+
+/******************************************************************************
+ *
+ *  Count idle time, call from the main idle loop
+ */
+
+void prof_idle(void)
+{
+    unsigned short now;
+    unsigned short gap;
+
+    now = prof_count();
+    gap = now - prof_last;
+    prof_last = now;
+    if (gap < PROF_IDLE_GAP)
+	prof_rest += gap;
+}
+
+/******************************************************************************
+ *
+ *  Get CPU load, percent of time not idle
+ *  in: non-zero to restart the measurement
+ */
+
+char prof_load(char clear)
+{
+    unsigned long total;
+    unsigned long idle;
+    unsigned long now;
+
+    now = prof_time();
+    total = (now - prof_mark) / 100;
+    idle = 0;
+    if (total)
+	idle = prof_rest / total;
+    if (idle > 100)
+	idle = 100;
+    if (clear) {
+	prof_mark = now;
+	prof_rest = 0;
+    }
+    return 100 - idle;
+}
+
+/******************************************************************************
+ *
+ *  Print profile points that have counts, and the CPU load
+ *  in: char put function, non-zero to clear after reading
+ */
+
+void prof_report(void (*putc)(char), char clear)
+{
+    PROF_STAT	stat;
+    char	id;
+
+    for (id = 0; id < PROF_POINTS; id++) {
+	prof_stat(id, &stat, clear);
+	if (!stat.count)
+	    continue;
+	putc('0' + id);
+	prof_num(putc, stat.min);
+	prof_num(putc, stat.max);
+	prof_num(putc, stat.sum / stat.count);
+	prof_num(putc, stat.count);
+	putc('\r');
+	putc('\n');
+    }
+    putc('l');
+    putc('o');
+    putc('a');
+    putc('d');
+    prof_num(putc, prof_load(clear));
+    putc('%');
+    putc('\r');
+    putc('\n');
+}
+
+/******************************************************************************
+ *
+ *  Timer 1 update interrupt
+ */
+
+void prof_isr(void) __interrupt (IRQ_TIM1)
+{
+    TIM1_SR1 = 0;
+    prof_ovfl++;
+}
+
+/******************************************************************************
+ *
+ *  Get timer 1 count (high byte first, which latches the low byte)
+ */
+
+static unsigned short prof_count(void)
+{
+    unsigned short count;
+
+    count = TIM1_CNTRH << 8;
+    count |= TIM1_CNTRL;
+    return count;
+}
+
+/******************************************************************************
+ *
+ *  Get 32 bit time in CPU clocks
+ *  If the counter has just wrapped and its interrupt is still pending,
+ *  the wrap count is one behind.
+ */
+
+static unsigned long prof_time(void)
+{
+    unsigned short ovfl;
+    unsigned short count;
+    char	cc;
+
+    cc = irq_save();
+    ovfl = prof_ovfl;
+    count = prof_count();
+    if ((TIM1_SR1 & 1) && count < 0x8000)
+	ovfl++;
+    irq_restore(cc);
+    return ((unsigned long)ovfl << 16) | count;
+}
+
+/******************************************************************************
+ *
+ *  Clear profile point
+ */
+
+static void prof_clear(char id)
+{
+    prof_tab[id].min   = 0xffff;
+    prof_tab[id].max   = 0;
+    prof_tab[id].sum   = 0;
+    prof_tab[id].count = 0;
+}
+
+/******************************************************************************
+ *
+ *  Print space and decimal number
+ */
+
+static void prof_num(void (*putc)(char), unsigned short val)
+{
+    char	buf[6];
+    char	*str;
+
+    putc(' ');
+    str = bin16_dec_rlz(val, buf);
+    while (*str)
+	putc(*str++);
+}
+#endif	/* LIB_PROFILE */
@@ -0,0 +1,116 @@
+/*
+ *  File name:  lib_prof.h
+ *  Date first: 10/19/2026
+ *  Date last:  10/19/2026
+ *
+ *  Description: STM8 Library for profiling interrupts and functions
+ *
+ *  Author:     Richard Hodges
+ *
+ *  Copyright (C) 2026 Richard Hodges. All rights reserved.
+ *  Permission is hereby granted for any use.
+ *
+ ******************************************************************************
+ *
+ *  Option to profile library code. When commented out, PROF_ENTER() and
+ *  PROF_EXIT() compile to nothing, lib_prof is empty and Timer 1 is free.
+ */
+
+//#define LIB_PROFILE
+
+/*
+ *  Profile points (0 to PROF_POINTS - 1)
+ *  Library points are below, the rest are free for the application.
+ */
+
+#define PROF_POINTS	8
+
+#define PROF_CLOCK	0	/* timer4_isr() or tim4_isr() */
+#define PROF_UART_RX	1	/* uart_rx_isr() */
+#define PROF_KEYPAD	2	/* keypad_poll() scan */
+
+/*
+ *  Mark entry and exit of code to profile. Interrupts taken in between
+ *  are included in the time. Times are limited to 65535 clocks
+ *  (4 ms at 16 mhz).
+ *
+ *  void my_isr(void) __interrupt (IRQ_X)
+ *  {
+ *      PROF_ENTER(PROF_MY);
+ *      ...
+ *      PROF_EXIT(PROF_MY);
+ *  }
+ */
+
+#ifdef LIB_PROFILE
+#define PROF_ENTER(id)	prof_enter(id)
+#define PROF_EXIT(id)	prof_exit(id)
+#else
+#define PROF_ENTER(id)
+#define PROF_EXIT(id)
+#endif
+
+typedef struct {
+    unsigned short min;		/* CPU clocks */
+    unsigned short max;
+    unsigned long  sum;		/* for average */
+    unsigned short count;	/* stops at 65535 */
+} PROF_STAT;
+
+/*
+ *  Initialize profiler
+ *  Timer 1 runs free at the CPU clock. The cost of PROF_ENTER/PROF_EXIT
+ *  is measured here and taken off every time.
+ */
+
+void prof_init(void);
+
+void prof_enter(char);
+void prof_exit(char);
+
+/*
+ *  Get profile point statistics
+ *  in: point number, stats out, non-zero to clear after reading
+ */
+
+void prof_stat(char, PROF_STAT *, char);
+
+/*
+ *  Count idle time, call on every pass of the main idle loop
+ *
+ *  Each gap since the last call under PROF_IDLE_GAP clocks is idle time.
+ *  Longer gaps had work or interrupts in them and count as busy. The
+ *  idle loop must not WFI, or all time counts as busy.
+ */
+
+#define PROF_IDLE_GAP	400	/* clocks, more than one idle loop pass */
+
+void prof_idle(void);
+
+/*
+ *  Get CPU load, percent of time not idle since the last clear
+ *  Read at least every 4 minutes (at 16 mhz) or the time wraps.
+ *  in: non-zero to restart the measurement
+ */
+
+char prof_load(char);
+
+/*
+ *  Print profile points with counts, eg from a CLI command:
+ *
+ *    "<point> <min> <max> <avg> <count>" in CPU clocks, then "load <n>%"
+ *
+ *  in: char put function, non-zero to clear after reading
+ */
+
+void prof_report(void (*)(char), char);
+
+#ifdef LIB_PROFILE
+/*
+ *  Interrupt prototypes must be included with main()
+ */
+
+#include "vectors.h"
+
+void prof_isr(void) __interrupt (IRQ_TIM1);
+#endif
@@ -0,0 +1,251 @@
+/*
+ *  File name:  lib_sched.c
+ *  Date first: 10/19/2026
+ *  Date last:  10/19/2026
+ *
+ *  Description: Cooperative run to completion task scheduler, with
+ *		 periodic tasks on lib_timer and events posted from ISRs.
+ *
+ *  Author:     Richard Hodges
+ *
+ *  Copyright (C) 2026 Richard Hodges. All rights reserved.
+ *  Permission is hereby granted for any use.
+ *
+ ******************************************************************************
+ *
+ *  Ready tasks are bits in sched_ready. The highest priority (lowest
+ *  numbered) ready task runs next. With nothing ready, interrupts are
+ *  disabled while the ready bits are checked, and WFI enables them
+ *  again as it waits, so a post from an ISR can not be missed.
+ */
+
+#include "stm8s_header.h"
+
+#include "lib_board.h"
+#include "lib_timer.h"
+#include "lib_sched.h"
+
+typedef struct {
+    TIMER	 timer;		/* first, to find task from timer */
+    void (*func)(void);
+    unsigned short posted;	/* time of first post */
+    SCHED_STAT	 stat;
+} SCHED_TASK;
+
+static void	sched_timer(TIMER *);
+static unsigned short sched_time(void);
+
+static SCHED_TASK sched_tab[SCHED_TASKS];
+static volatile unsigned char sched_ready;
+static void	(*sched_hook)(void);
+
+static unsigned long sched_busy;	/* time in tasks */
+static unsigned long sched_rest;	/* time in WFI */
+
+/******************************************************************************
+ *
+ *  Initialize scheduler (no tasks)
+ */
+
+void sched_init(void)
+{
+    char	i;
+
+    for (i = 0; i < SCHED_TASKS; i++) {
+	timer_stop(&sched_tab[i].timer);
+	sched_tab[i].func = 0;
+    }
+    sched_ready = 0;
+    sched_hook = 0;
+    sched_load(1);
+}
+
+/******************************************************************************
+ *
+ *  Set task
+ *  in: task number, function, period (ms, zero = only when posted)
+ */
+
+void sched_task(char id, void (*func)(void), unsigned short period)
+{
+    SCHED_TASK	*task;
+
+    task = &sched_tab[id];
+    task->func = func;
+    task->stat.lat_max = 0;
+    task->stat.run_max = 0;
+    task->stat.runs = 0;
+    if (period)
+	timer_start(&task->timer, sched_timer, period, period);
+    else
+	timer_stop(&task->timer);
+}
+
+/******************************************************************************
+ *
+ *  Make task ready to run (main or interrupt)
+ *  in: task number
+ */
+
+void sched_post(char id)
+{
+    unsigned char bit;
+    char	cc;
+
+    bit = 1 << id;
+    cc = irq_save();
+    if (!(sched_ready & bit)) {
+	sched_tab[id].posted = sched_time();
+	sched_ready |= bit;
+    }
+    irq_restore(cc);
+}
+
+/******************************************************************************
+ *
+ *  Set idle hook, called before each idle WFI
+ */
+
+void sched_idle(void (*hook)(void))
+{
+    sched_hook = hook;
+}
+
+/******************************************************************************
+ *
+ *  Run tasks forever
+ */
+
+void sched_run(void)
+{
+    SCHED_TASK	*task;
+    unsigned char bit;
+    unsigned short start;
+    unsigned short time;
+    char	id;
+    char	cc;
+
+    while (1) {
+	if (!sched_ready) {
+	    if (sched_hook)
+		sched_hook();
+	    __asm__ ("sim");
+	    if (sched_ready) {
+		__asm__ ("rim");
+		continue;
+	    }
+	    start = sched_time();
+	    __asm__ ("wfi");		/* enables interrupts */
+	    sched_rest += (unsigned short)(sched_time() - start);
+	    continue;
+	}
+
+	id = 0;
+	bit = 1;
+	while (!(sched_ready & bit)) {
+	    id++;
+	    bit <<= 1;
+	}
+	task = &sched_tab[id];
+
+	cc = irq_save();
+	sched_ready &= ~bit;
+	irq_restore(cc);
+
+	start = sched_time();
+	time = start - task->posted;
+	if (time > task->stat.lat_max)
+	    task->stat.lat_max = time;
+
+	if (task->func)
+	    task->func();
+
+	time = sched_time() - start;
+	if (time > task->stat.run_max)
+	    task->stat.run_max = time;
+	task->stat.runs++;
+	sched_busy += time;
+    }
+}
+
+/******************************************************************************
+ *
+ *  Get task statistics
+ *  in: task number, stats out, non-zero to clear after reading
+ */
+
+void sched_stat(char id, SCHED_STAT *stat, char clear)
+{
+    SCHED_TASK	*task;
+
+    task = &sched_tab[id];
+    stat->lat_max = task->stat.lat_max;
+    stat->run_max = task->stat.run_max;
+    stat->runs    = task->stat.runs;
+    if (clear) {
+	task->stat.lat_max = 0;
+	task->stat.run_max = 0;
+	task->stat.runs = 0;
+    }
+}
+
+/******************************************************************************
+ *
+ *  Get CPU load, percent of measured time spent in tasks
+ *  in: non-zero to restart the measurement
+ */
+
+char sched_load(char clear)
+{
+    unsigned long total;
+    unsigned long load;
+
+    total = sched_busy + sched_rest;
+    if (total < 100)		/* small, no overflow */
+	load = total ? (sched_busy * 100) / total : 0;
+    else
+	load = sched_busy / (total / 100);
+    if (load > 100)
+	load = 100;
+    if (clear) {
+	sched_busy = 0;
+	sched_rest = 0;
+    }
+    return load;
+}
+
+/******************************************************************************
+ *
+ *  Task period timer (from timer interrupt)
+ */
+
+static void sched_timer(TIMER *t)
+{
+    sched_post((SCHED_TASK *)t - sched_tab);
+}
+
+/******************************************************************************
+ *
+ *  Get time in TIM4 counts, modulo 65536
+ *
+ *  Millisecond count times counts per millisecond, plus the counter. If
+ *  the counter has just wrapped and its interrupt is still pending, the
+ *  millisecond count is one behind.
+ */
+
+static unsigned short sched_time(void)
+{
+    unsigned short ms;
+    unsigned char cnt;
+    unsigned char top;
+    char	cc;
+
+    cc = irq_save();
+    ms  = timer_ticks();
+    cnt = TIM4_CNTR;
+    top = TIM4_ARR;
+    if ((TIM4_SR & 1) && cnt < (top >> 1))
+	ms++;
+    irq_restore(cc);
+    return ms * (top + 1) + cnt;
+}
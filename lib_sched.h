@@ -0,0 +1,77 @@
+/*
+ *  File name:  lib_sched.h
+ *  Date first: 10/19/2026
+ *  Date last:  10/19/2026
+ *
+ *  Description: Cooperative run to completion task scheduler, with
+ *		 periodic tasks on lib_timer and events posted from ISRs.
+ *
+ *  Author:     Richard Hodges
+ *
+ *  Copyright (C) 2026 Richard Hodges. All rights reserved.
+ *  Permission is hereby granted for any use.
+ *
+ ******************************************************************************
+ *
+ *  Task numbers are 0 to SCHED_TASKS - 1, and are also the priority
+ *  (0 runs first). A task runs when posted, or when its period expires.
+ *  Each run goes to completion, so tasks must not wait in loops.
+ *
+ *  Times are in TIM4 counts (4 us with the lib_clock/lib_tim4 setup),
+ *  and are valid for spans up to 65535 counts (262 ms).
+ */
+
+#define SCHED_TASKS	8
+
+typedef struct {
+    unsigned short lat_max;	/* worst time from post to start */
+    unsigned short run_max;	/* longest run */
+    unsigned short runs;	/* number of runs */
+} SCHED_STAT;
+
+/*
+ *  Initialize scheduler (no tasks)
+ *  lib_timer must be ticking from clock_init() or tim4_init().
+ */
+
+void sched_init(void);
+
+/*
+ *  Set task
+ *  in: task number, function, period (ms, zero = only when posted)
+ */
+
+void sched_task(char, void (*)(void), unsigned short);
+
+/*
+ *  Make task ready to run, callable from interrupts
+ *  in: task number
+ */
+
+void sched_post(char);
+
+/*
+ *  Set idle hook, called before each idle WFI (NULL for none)
+ */
+
+void sched_idle(void (*)(void));
+
+/*
+ *  Run tasks forever, WFI when nothing is ready
+ */
+
+void sched_run(void);
+
+/*
+ *  Get task statistics
+ *  in: task number, stats out, non-zero to clear after reading
+ */
+
+void sched_stat(char, SCHED_STAT *, char);
+
+/*
+ *  Get CPU load, percent of measured time spent in tasks
+ *  in: non-zero to restart the measurement
+ */
+
+char sched_load(char);
@@ -1,13 +1,13 @@
 /*
  *  File name:  lib_tim4.c
  *  Date first: 03/23/2018
- *  Date last:  12/02/2018
+ *  Date last:  10/19/2026
  *
  *  Description: Library for millisecond and 1/10 second callbacks using tim4.
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2018-2020 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2018-2020, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  *  This is a stripped version of lib_clock.
@@ -19,6 +19,7 @@
 #include "stm8s_header.h"
 
 #include "lib_tim4.h"
+#include "lib_prof.h"
 
 static signed char clock_ms;	/* milliseconds, may be negative with trim */
 
@@ -57,13 +58,14 @@ void tim4_init(void (*call_ms)(void), void (*call_10)(void))
 
 void tim4_isr(void) __interrupt (IRQ_TIM4)
 {
+    PROF_ENTER(PROF_CLOCK);
     TIM4_SR = 0;		/* clear the interrupt */
 
     timer_ms();
     clock_ms++;
-    if (clock_ms < 100)
-	return;
-    clock_ms -= 100;
-
-    timer_10();
+    if (clock_ms >= 100) {
+	clock_ms -= 100;
+	timer_10();
+    }
+    PROF_EXIT(PROF_CLOCK);
 }
@@ -0,0 +1,255 @@
+/*
+ *  File name:  lib_timer.c
+ *  Date first: 10/19/2026
+ *  Date last:  10/19/2026
+ *
+ *  Description: Software timers on a two level timer wheel, driven from
+ *		 the millisecond callback of lib_clock or lib_tim4.
+ *
+ *  Author:     Richard Hodges
+ *
+ *  Copyright (C) 2026 Richard Hodges. All rights reserved.
+ *  Permission is hereby granted for any use.
+ *
+ ******************************************************************************
+ *
+ *  Level 0 has a slot for each of the next 16 milliseconds. Level 1 has
+ *  a slot for each 16 ms block. When the tick count enters a new block,
+ *  the timers in that block's level 1 slot are moved down to level 0.
+ *  Timers more than 256 ms away wait in level 1 and are moved again
+ *  each time their slot comes round, until they are close enough.
+ *
+ *  Start and stop are constant time, and a tick only touches the timers
+ *  that are due (plus, every 16 ticks, one level 1 slot).
+ */
+
+#include "stm8s_header.h"
+
+#include "lib_board.h"
+#include "lib_timer.h"
+
+#define WHEEL_SLOTS	16
+#define WHEEL_MASK	(WHEEL_SLOTS - 1)
+
+static void	timer_insert(TIMER *);
+static void	timer_remove(TIMER *);
+static void	timer_cascade(void);
+
+static TIMER	*wheel0[WHEEL_SLOTS];	/* 1 ms slots */
+static TIMER	*wheel1[WHEEL_SLOTS];	/* 16 ms slots */
+
+static unsigned short timer_now;	/* free running ms count */
+
+/******************************************************************************
+ *
+ *  Initialize timers (no timers running)
+ */
+
+void timer_init(void)
+{
+    char	i;
+
+    for (i = 0; i < WHEEL_SLOTS; i++) {
+	wheel0[i] = 0;
+	wheel1[i] = 0;
+    }
+    timer_now = 0;
+}
+
+/******************************************************************************
+ *
+ *  Start or restart timer
+ *  in: timer, callback, first delay (ms, 1-65535), period (zero = once)
+ */
+
+void timer_start(TIMER *t, void (*func)(TIMER *),
+		 unsigned short delay, unsigned short period)
+{
+    char	cc;
+
+    if (!delay)
+	delay = 1;
+
+    cc = irq_save();
+    if (t->prev)
+	timer_remove(t);
+    t->func   = func;
+    t->period = period;
+    t->expire = timer_now + delay;
+    timer_insert(t);
+    irq_restore(cc);
+}
+
+/******************************************************************************
+ *
+ *  Stop timer
+ */
+
+void timer_stop(TIMER *t)
+{
+    char	cc;
+
+    cc = irq_save();
+    if (t->prev)
+	timer_remove(t);
+    irq_restore(cc);
+}
+
+/******************************************************************************
+ *
+ *  Get free running millisecond count
+ */
+
+unsigned short timer_ticks(void)
+{
+    unsigned short now;
+    char	cc;
+
+    cc = irq_save();
+    now = timer_now;
+    irq_restore(cc);
+    return now;
+}
+
+/******************************************************************************
+ *
+ *  Advance timers one millisecond (from timer interrupt)
+ */
+
+void timer_tick(void)
+{
+    TIMER	*t;
+    TIMER	**slot;
+
+    timer_now++;
+    if (!(timer_now & WHEEL_MASK))
+	timer_cascade();
+
+    slot = &wheel0[timer_now & WHEEL_MASK];
+    while ((t = *slot)) {
+	timer_remove(t);
+	if (t->period) {
+	    t->expire += t->period;
+	    timer_insert(t);
+	}
+	t->func(t);
+    }
+}
+
+/******************************************************************************
+ *
+ *  Get milliseconds until the next timer runs
+ *  out: 1-65535, 0xffff if no timers
+ */
+
+unsigned short timer_next(void)
+{
+    TIMER	*t;
+    unsigned short next;
+    unsigned short ms;
+    char	cc;
+    char	i;
+
+    next = 0xffff;
+    cc = irq_save();
+    for (i = 1; i < WHEEL_SLOTS; i++) {
+	if (wheel0[(timer_now + i) & WHEEL_MASK]) {
+	    next = i;
+	    break;
+	}
+    }
+    for (i = 0; i < WHEEL_SLOTS; i++) {		/* may be sooner */
+	for (t = wheel1[i]; t; t = t->next) {
+	    ms = t->expire - timer_now;
+	    if (ms < next)
+		next = ms;
+	}
+    }
+    irq_restore(cc);
+    return next;
+}
+
+/******************************************************************************
+ *
+ *  Advance timers after time without ticks (eg, clock_halt)
+ *  in: milliseconds, no more than timer_next()
+ *
+ *  Only the last millisecond can have timers due. Level 1 slots passed
+ *  on the way are moved down as usual.
+ */
+
+void timer_skip(unsigned short ms)
+{
+    unsigned short step;
+    char	cc;
+
+    if (!ms)
+	return;
+
+    cc = irq_save();
+    step = WHEEL_SLOTS - (timer_now & WHEEL_MASK);
+    while (ms > step) {
+	timer_now += step;
+	ms -= step;
+	timer_cascade();
+	step = WHEEL_SLOTS;
+    }
+    timer_now += ms - 1;
+    timer_tick();
+    irq_restore(cc);
+}
+
+/******************************************************************************
+ *
+ *  Move timers in level 1 slot for the new 16 ms block down
+ */
+
+static void timer_cascade(void)
+{
+    TIMER	*t;
+    TIMER	*next;
+    TIMER	**slot;
+
+    slot = &wheel1[(timer_now >> 4) & WHEEL_MASK];
+    t = *slot;
+    *slot = 0;
+    while (t) {
+	next = t->next;
+	timer_insert(t);
+	t = next;
+    }
+}
+
+/******************************************************************************
+ *
+ *  Put timer in wheel slot for its expire time
+ */
+
+static void timer_insert(TIMER *t)
+{
+    TIMER	**slot;
+
+    if ((unsigned short)(t->expire - timer_now) < WHEEL_SLOTS)
+	slot = &wheel0[t->expire & WHEEL_MASK];
+    else
+	slot = &wheel1[(t->expire >> 4) & WHEEL_MASK];
+
+    t->next = *slot;
+    if (t->next)
+	t->next->prev = &t->next;
+    t->prev = slot;
+    *slot = t;
+}
+
+/******************************************************************************
+ *
+ *  Take timer out of its slot
+ */
+
+static void timer_remove(TIMER *t)
+{
+    *t->prev = t->next;
+    if (t->next)
+	t->next->prev = t->prev;
+    t->prev = 0;
+}
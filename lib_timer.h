@@ -0,0 +1,73 @@
+/*
+ *  File name:  lib_timer.h
+ *  Date first: 10/19/2026
+ *  Date last:  10/19/2026
+ *
+ *  Description: Software timers on a two level timer wheel, driven from
+ *		 the millisecond callback of lib_clock or lib_tim4.
+ *
+ *  Author:     Richard Hodges
+ *
+ *  Copyright (C) 2026 Richard Hodges. All rights reserved.
+ *  Permission is hereby granted for any use.
+ *
+ ******************************************************************************
+ *
+ *  Timer structure, owned by the caller. Must be zero (eg, static)
+ *  before it is first started.
+ */
+
+typedef struct timer {
+    struct timer *next;		/* private */
+    struct timer **prev;	/* private, NULL = not running */
+    unsigned short expire;	/* private, tick count to run */
+    unsigned short period;	/* zero = one shot */
+    void (*func)(struct timer *);
+} TIMER;
+
+/*
+ *  Initialize timers (no timers running)
+ */
+
+void timer_init(void);
+
+/*
+ *  Start or restart timer
+ *  Callback runs from the timer interrupt, so it should be short.
+ *  in: timer, callback, first delay (ms, 1-65535), period (zero = once)
+ */
+
+void timer_start(TIMER *, void (*)(TIMER *), unsigned short, unsigned short);
+
+/*
+ *  Stop timer (does nothing if not running)
+ */
+
+void timer_stop(TIMER *);
+
+/*
+ *  Advance timers one millisecond
+ *  Pass as the millisecond callback to clock_init() or tim4_init().
+ */
+
+void timer_tick(void);
+
+/*
+ *  Get free running millisecond count
+ */
+
+unsigned short timer_ticks(void);
+
+/*
+ *  Get milliseconds until the next timer runs (0xffff if no timers)
+ *  Used with timer_skip() to sleep without ticks, see clock_halt().
+ */
+
+unsigned short timer_next(void);
+
+/*
+ *  Advance timers by time spent without ticks
+ *  in: milliseconds, no more than timer_next()
+ */
+
+void timer_skip(unsigned short);
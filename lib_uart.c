@@ -1,13 +1,13 @@
 /*
  *  File name:  lib_uart.c
  *  Date first: 12/30/2017
- *  Date last:  12/13/2022
+ *  Date last:  10/19/2026
  *
  *  Description: STM8 Library for UART1 and UART2
  *
  *  Author:     Richard Hodges
  *
- *  Copyright (C) 2017, 2018 Richard Hodges. All rights reserved.
+ *  Copyright (C) 2017, 2018, 2026 Richard Hodges. All rights reserved.
  *  Permission is hereby granted for any use.
  *
  ******************************************************************************
@@ -16,6 +16,7 @@
 #include "stm8s_header.h"
 
 #include "lib_uart.h"
+#include "lib_prof.h"
 
 /*
  *  Buffers and counters
@@ -161,6 +162,7 @@ void uart_rx_isr(void) __interrupt (IRQ_UART_RX)
 {
     char	rxbyte, new_ptr;
 
+    PROF_ENTER(PROF_UART_RX);
     if (UART_SR & SR_OR)
 	rx_overruns++;
     rxbyte = UART_DR;
@@ -171,4 +173,5 @@ void uart_rx_isr(void) __interrupt (IRQ_UART_RX)
 	rx_put = new_ptr;
     else
 	buf_overruns++;
+    PROF_EXIT(PROF_UART_RX);
 }
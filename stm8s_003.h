@@ -80,6 +80,9 @@
 #define CLK_HSITRIMR	PTR(0x50cc)	// HSI clock calibration trimming
 #define CLK_SWIMCCR	PTR(0x50cd)	// SWIM clock control
 
+#define AWU_CSR		PTR(0x50f0)	// Auto wakeup control/status
+#define AWU_APR		PTR(0x50f1)	// Auto wakeup prescaler
+#define AWU_TBR		PTR(0x50f2)	// Auto wakeup time base
 #define BEEP_CSR	PTR(0x50f3)	// BEEP control
 
 #define SPI_CR1		PTR(0x5200)	// SPI control #1
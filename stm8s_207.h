@@ -92,6 +92,9 @@
  * AWU
  */
 
+#define AWU_CSR		PTR(0x50f0)	// Auto wakeup control/status
+#define AWU_APR		PTR(0x50f1)	// Auto wakeup prescaler
+#define AWU_TBR		PTR(0x50f2)	// Auto wakeup time base
 #define BEEP_CSR	PTR(0x50f3)	// BEEP control
 
 #define SPI_CR1		PTR(0x5200)	// SPI control #1
@@ -0,0 +1,169 @@
+/*
+ *  File name:  test_aes.c
+ *  Date first: 10/19/2026
+ *  Date last:  10/19/2026
+ *
+ *  Description: Host test for aes_stm8 (make test)
+ *
+ *  Author:     Richard Hodges
+ *
+ *  Copyright (C) 2026 Richard Hodges. All rights reserved.
+ *  Permission is hereby granted for any use.
+ *
+ ******************************************************************************
+ *
+ *  Built with the C versions of the assembly functions (-DORIG_C) and
+ *  the known answer self test (-DAES_SELFTEST). CCM is checked against
+ *  RFC 3610. The throughput shown is for the host build. To measure on
+ *  target, put PROF_ENTER()/PROF_EXIT() from lib_prof around the calls,
+ *  and prof_report() gives CPU clocks.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "aes_stm8.h"
+#include "aes_ccm.h"
+
+#define TEST_BLOCKS	4		/* blocks per aes_encrypt_blocks() */
+#define TIME_BLOCKS	200000L		/* blocks for the throughput */
+
+static BYTE test_key[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+/******************************************************************************
+ *
+ *  Check that a multi block call matches single block calls
+ *  out: zero = pass
+ */
+
+static int test_blocks(AES_CTX *ctx)
+{
+    BYTE	one[TEST_BLOCKS * 16];
+    BYTE	many[TEST_BLOCKS * 16];
+    int		i;
+
+    for (i = 0; i < TEST_BLOCKS * 16; i++)
+	one[i] = i * 7;
+    memcpy(many, one, sizeof(many));
+
+    aes_new_key(ctx, test_key);
+    for (i = 0; i < TEST_BLOCKS; i++)
+	aes_encrypt(ctx, one + i * 16);
+    aes_encrypt_blocks(ctx, many, TEST_BLOCKS);
+    return memcmp(one, many, sizeof(one));
+}
+
+/******************************************************************************
+ *
+ *  CCM packet vector #1 from RFC 3610: encrypt and tag, decrypt, and
+ *  a changed tag that must fail
+ *  out: zero = pass, else number of failed step
+ */
+
+static const BYTE ccm_key[16] = {
+    0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+    0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf
+};
+
+static const BYTE ccm_nonce[CCM_NONCE] = {
+    0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00, 0xa0,
+    0xa1, 0xa2, 0xa3, 0xa4, 0xa5
+};
+
+static const BYTE ccm_cipher[23 + 8] = {
+    0x58, 0x8c, 0x97, 0x9a, 0x61, 0xc6, 0x63, 0xd2,
+    0xf0, 0x66, 0xd0, 0xc2, 0xc0, 0xf9, 0x89, 0x80,
+    0x6d, 0x5f, 0x6b, 0x61, 0xda, 0xc3, 0x84,
+    0x17, 0xe8, 0xd1, 0x2c, 0xfd, 0xf9, 0x26, 0xe0	/* tag */
+};
+
+static int test_ccm(AES_CTX *ctx)
+{
+    BYTE	header[8];
+    BYTE	plain[23];
+    BYTE	data[23];
+    BYTE	tag[8];
+    int		i;
+
+    for (i = 0; i < 8; i++)
+	header[i] = i;
+    for (i = 0; i < 23; i++)
+	plain[i] = 8 + i;
+
+    aes_new_key(ctx, (BYTE *)ccm_key);
+    memcpy(data, plain, 23);
+    if (aes_ccm_encrypt(ctx, (BYTE *)ccm_nonce, header, 8, data, 23, tag, 8))
+	return 1;
+    if (memcmp(data, ccm_cipher, 23) || memcmp(tag, ccm_cipher + 23, 8))
+	return 2;
+
+    if (aes_ccm_decrypt(ctx, (BYTE *)ccm_nonce, header, 8, data, 23, tag, 8))
+	return 3;
+    if (memcmp(data, plain, 23))
+	return 4;
+
+    memcpy(data, ccm_cipher, 23);
+    tag[7] ^= 0x01;
+    if (!aes_ccm_decrypt(ctx, (BYTE *)ccm_nonce, header, 8, data, 23, tag, 8))
+	return 5;
+    return 0;
+}
+
+/******************************************************************************
+ *
+ *  Time encryption with one or TEST_BLOCKS blocks per call
+ *  out: blocks per second
+ */
+
+static long time_blocks(AES_CTX *ctx, int per_call)
+{
+    BYTE	buf[TEST_BLOCKS * 16];
+    clock_t	start;
+    double	secs;
+    long	n;
+
+    memset(buf, 0, sizeof(buf));
+    start = clock();
+    for (n = 0; n < TIME_BLOCKS; n += per_call) {
+	if (per_call == 1)
+	    aes_encrypt(ctx, buf);
+	else
+	    aes_encrypt_blocks(ctx, buf, per_call);
+    }
+    secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if (secs <= 0)
+	return 0;
+    return TIME_BLOCKS / secs;
+}
+
+int main(void)
+{
+    AES_CTX	ctx;
+    char	fail;
+
+    fail = aes_selftest(&ctx);
+    if (fail) {
+	printf("test_aes: known answer vector %d failed\n", fail);
+	return 1;
+    }
+    if (test_blocks(&ctx)) {
+	printf("test_aes: aes_encrypt_blocks() does not match aes_encrypt()\n");
+	return 1;
+    }
+    fail = test_ccm(&ctx);
+    if (fail) {
+	printf("test_aes: CCM packet vector 1 failed step %d\n", fail);
+	return 1;
+    }
+    printf("test_aes: pass\n");
+
+    aes_new_key(&ctx, test_key);
+    printf("test_aes: host C code, blocks/s: aes_encrypt %ld, "
+	   "aes_encrypt_blocks(%d) %ld\n", time_blocks(&ctx, 1),
+	   TEST_BLOCKS, time_blocks(&ctx, TEST_BLOCKS));
+    return 0;
+}
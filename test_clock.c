@@ -0,0 +1,295 @@
+/*
+ *  File name:  test_clock.c
+ *  Date first: 10/19/2026
+ *  Date last:  10/19/2026
+ *
+ *  Description: Host test for lib_clock (make test)
+ *
+ *  Author:     Richard Hodges
+ *
+ *  Copyright (C) 2026 Richard Hodges. All rights reserved.
+ *  Permission is hereby granted for any use.
+ *
+ ******************************************************************************
+ *
+ *  The library is built in with timer 4 as plain bytes, and the clock
+ *  is run by calling the interrupt handler once per millisecond.
+ */
+
+#include <stdio.h>
+
+unsigned char TIM4_PSCR, TIM4_ARR, TIM4_CR1, TIM4_IER, TIM4_SR;
+unsigned char CLK_ICKR, AWU_APR, AWU_TBR, AWU_CSR;
+
+#define __interrupt(x)
+
+#include "lib_clock.c"
+
+static int fails;
+
+static void no_call(void)
+{
+}
+
+/******************************************************************************
+ *
+ *  Stand-ins for lib_board and lib_bindec
+ */
+
+char irq_save(void)
+{
+    return 0;
+}
+
+void irq_restore(char cc)
+{
+    (void)cc;
+}
+
+void bin8_dec2(char val, char *buf)
+{
+    buf[0] = '0' + val / 10;
+    buf[1] = '0' + val % 10;
+    buf[2] = 0;
+}
+
+int dec_bin16(char *str)
+{
+    int		val;
+
+    val = 0;
+    while (*str >= '0' && *str <= '9')
+	val = val * 10 + *str++ - '0';
+    return val;
+}
+
+/******************************************************************************
+ *
+ *  Run the clock for some seconds
+ */
+
+static void run_secs(unsigned long secs)
+{
+    unsigned long ms;
+
+    for (ms = secs * 1000; ms; ms--)
+	timer4_isr();
+}
+
+/******************************************************************************
+ *
+ *  Check one value
+ *  out: zero = as expected
+ */
+
+static int check(const char *what, unsigned long got, unsigned long want)
+{
+    if (got == want)
+	return 0;
+    printf("test_clock: %s is %lu, expected %lu\n", what, got, want);
+    fails++;
+    return 1;
+}
+
+/******************************************************************************
+ *
+ *  Check calendar date and day of week
+ *  out: zero = as expected
+ */
+
+static int check_cal(const char *what, CLOCK_CAL *cal,
+		     int year, int month, int date, int day)
+{
+    if (cal->year == year && cal->month == month &&
+	cal->date == date && cal->day == day)
+	return 0;
+    printf("test_clock: %s is %d-%02d-%02d day %d, expected "
+	   "%d-%02d-%02d day %d\n", what, cal->year, cal->month, cal->date,
+	   cal->day, year, month, date, day);
+    fails++;
+    return 1;
+}
+
+/******************************************************************************
+ *
+ *  Set the time of day after the day count has rolled over
+ */
+
+static void test_bin_set(void)
+{
+    CLOCK_CAL	cal;
+    char	vals[4];
+
+    clock_init(no_call, no_call);
+    run_secs(3 * 86400L + 3600);		/* 2000-01-04 01:00:00 */
+
+    clock_bin_get(vals);
+    check("day count", vals[0], 3);
+
+    vals[0] = 0;				/* 12:30:15 */
+    vals[1] = 12;
+    vals[2] = 30;
+    vals[3] = 15;
+    clock_bin_set(vals);
+
+    check("epoch after set", clock_seconds(), 3 * 86400L + 45015);
+    clock_cal_get(&cal);
+    check("date after set", cal.date, 4);
+
+    clock_bin_get(vals);
+    check("day count after set", vals[0], 0);
+    check("hours after set", vals[1], 12);
+
+    run_secs(12 * 3600L);			/* past midnight */
+    check("epoch next day", clock_seconds(), 4 * 86400L + 1815);
+    clock_cal_get(&cal);
+    check("date next day", cal.date, 5);
+    clock_bin_get(vals);
+    check("day count next day", vals[0], 1);
+
+    vals[0] = 200;				/* far from the count */
+    clock_bin_set(vals);
+    check("epoch after day 200", clock_seconds(), 4 * 86400L + 1815);
+}
+
+/******************************************************************************
+ *
+ *  Set the seconds counter, day count stays
+ */
+
+static void test_seconds_set(void)
+{
+    CLOCK_CAL	cal;
+    char	vals[4];
+
+    clock_init(no_call, no_call);
+    run_secs(2 * 86400L);
+    clock_seconds_set(400 * 86400L + 7384);	/* 2001-02-04 02:03:04 */
+
+    clock_bin_get(vals);
+    check("seconds set day count", vals[0], 2);
+    check("seconds set hours", vals[1], 2);
+    check("seconds set mins", vals[2], 3);
+    check("seconds set secs", vals[3], 4);
+    clock_cal_get(&cal);
+    check("seconds set month", cal.month, 2);
+    check("seconds set date", cal.date, 4);
+}
+
+/******************************************************************************
+ *
+ *  Leap year for the reference calendar, written apart from the library
+ */
+
+static int ref_leap(int year)
+{
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+/******************************************************************************
+ *
+ *  Walk every day from 2000 to 2199 with a reference calendar. Check
+ *  clock_inc_calendar() on each day, and the epoch round trip on each
+ *  day the 32 bit epoch reaches (to 2135).
+ */
+
+static void test_calendar(void)
+{
+    static const char mdays[12] = {
+	31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+    };
+    CLOCK_CAL	cal;
+    char	hms[3];
+    unsigned long day;
+    unsigned long secs;
+    int		year, month, date, wday;
+
+    year  = 2000;
+    month = 1;
+    date  = 1;
+    wday  = 6;				/* Saturday */
+    calendar.year  = year;
+    calendar.month = month;
+    calendar.date  = date;
+    calendar.day   = wday;
+
+    for (day = 0; year < 2200; day++) {
+	if (check_cal("clock_inc_calendar()", &calendar,
+		      year, month, date, wday))
+	    return;
+
+	if (year < 2136) {
+	    secs = day * 86400 + (day * 3607) % 86400;
+	    clock_epoch_cal(secs, &cal, hms);
+	    if (check_cal("clock_epoch_cal()", &cal,
+			  year, month, date, wday) ||
+		check("clock_epoch_cal() time", hms[0] * 3600L +
+		      hms[1] * 60 + hms[2], (day * 3607) % 86400) ||
+		check("clock_cal_epoch()", clock_cal_epoch(&cal, hms), secs))
+		return;
+	}
+
+	clock_inc_calendar();
+	wday = wday % 7 + 1;
+	date++;
+	if (date > mdays[month - 1] + (month == 2 && ref_leap(year))) {
+	    date = 1;
+	    month++;
+	    if (month > 12) {
+		month = 1;
+		year++;
+	    }
+	}
+    }
+}
+
+/******************************************************************************
+ *
+ *  Leap days and days of the week at known dates
+ */
+
+static void test_dates(void)
+{
+    CLOCK_CAL	cal;
+
+    cal.year  = 2100;			/* not a leap year */
+    cal.month = 2;
+    cal.date  = 28;
+    clock_epoch_cal(clock_cal_epoch(&cal, 0) + 86400, &cal, 0);
+    check_cal("2100-02-28 + 1 day", &cal, 2100, 3, 1, 1);
+
+    calendar.year  = 2100;
+    calendar.month = 2;
+    calendar.date  = 28;
+    calendar.day   = 7;
+    clock_inc_calendar();
+    check_cal("2100-02-28 next day", &calendar, 2100, 3, 1, 1);
+
+    cal.year  = 2000;			/* leap year */
+    cal.month = 2;
+    cal.date  = 29;
+    check("2000-02-29 epoch", clock_cal_epoch(&cal, 0), 59 * 86400L);
+    clock_epoch_cal(59 * 86400L, &cal, 0);
+    check_cal("2000-02-29", &cal, 2000, 2, 29, 2);
+
+    clock_epoch_cal(0, &cal, 0);
+    check_cal("2000-01-01", &cal, 2000, 1, 1, 6);
+    clock_epoch_cal(8951 * 86400L, &cal, 0);
+    check_cal("2024-07-04", &cal, 2024, 7, 4, 4);
+    clock_epoch_cal(13898 * 86400L, &cal, 0);
+    check_cal("2038-01-19", &cal, 2038, 1, 19, 2);
+    clock_epoch_cal(49672 * 86400L, &cal, 0);
+    check_cal("2135-12-31", &cal, 2135, 12, 31, 6);
+}
+
+int main(void)
+{
+    test_bin_set();
+    test_seconds_set();
+    test_calendar();
+    test_dates();
+    if (fails)
+	return 1;
+    printf("test_clock: pass\n");
+    return 0;
+}